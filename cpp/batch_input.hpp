@@ -0,0 +1,194 @@
+#ifndef MAGNUS_LIBER_BATCH_INPUT_HPP
+#define MAGNUS_LIBER_BATCH_INPUT_HPP
+
+#include "mapped_file.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Call `line` with every line of `text`, without its newline.
+// The text is compared with newlines 32 bytes at a time with AVX2, or 16 bytes at a time with SSE2 or NEON, and
+// every newline of a block is found from the bits of the comparison, instead of a call to find each one.
+template<typename Line>
+void scanLines(std::string_view text, Line line)
+{
+    const auto* data = text.data();
+    std::size_t start = 0;
+    std::size_t i = 0;
+
+    auto emit = [&](std::size_t end) {
+        line(text.substr(start, end - start));
+        start = end + 1;
+    };
+
+#if defined(__AVX2__)
+    auto newline = _mm256_set1_epi8('\n');
+
+    for (; i + 32 <= text.size(); i += 32)
+    {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+
+        for (; mask != 0; mask &= mask - 1)
+        {
+            emit(i + std::countr_zero(mask));
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    auto newline = _mm_set1_epi8('\n');
+
+    for (; i + 16 <= text.size(); i += 16)
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+
+        for (; mask != 0; mask &= mask - 1)
+        {
+            emit(i + std::countr_zero(mask));
+        }
+    }
+#elif defined(__ARM_NEON)
+    auto newline = vdupq_n_u8('\n');
+
+    for (; i + 16 <= text.size(); i += 16)
+    {
+        // NEON has no movemask: narrow the comparison to 4 bits per byte instead
+        auto matches = vceqq_u8(vld1q_u8(reinterpret_cast<const std::uint8_t*>(data + i)), newline);
+        auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+
+        while (mask != 0)
+        {
+            auto bit = std::countr_zero(mask);
+            emit(i + bit / 4);
+            mask &= ~(std::uint64_t(0xf) << bit);
+        }
+    }
+#endif
+
+    for (; i < text.size(); ++i)
+    {
+        if (data[i] == '\n')
+        {
+            emit(i);
+        }
+    }
+
+    if (start < text.size())
+    {
+        line(text.substr(start));
+    }
+}
+
+// The questions of a batch file, memory-mapped rather than read.
+//
+// The file has one question per line, as plain text or as JSON Lines objects with a "question" string. Blank
+// lines are skipped. Questions are views into the mapping, so they go to the request body without a copy; only
+// JSON strings with escape sequences are decoded into strings of their own.
+class BatchInput
+{
+public:
+    explicit BatchInput(const std::string& path)
+        : mapping(path)
+    {
+        std::size_t lineNumber = 0;
+
+        scanLines(mapping.view(), [&](std::string_view line) {
+            ++lineNumber;
+
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+            {
+                line.remove_suffix(1);
+            }
+
+            while (!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+            {
+                line.remove_prefix(1);
+            }
+
+            if (line.empty())
+            {
+                return;
+            }
+
+            if (line.front() != '{')
+            {
+                questionViews.push_back(line);
+            }
+            else if (auto question = readQuestion(line))
+            {
+                questionViews.push_back(*question);
+            }
+            else
+            {
+                std::cerr << "Warning: Line " << lineNumber << " of " << path << " has no \"question\" string, skipped." << std::endl;
+            }
+        });
+    }
+
+    std::span<const std::string_view> questions() const
+    {
+        return questionViews;
+    }
+
+private:
+    // The "question" string of a JSON object, or nothing
+    std::optional<std::string_view> readQuestion(std::string_view line)
+    {
+        // Most records have a plain string: take it from the mapping without parsing the rest of the object
+        auto skipSpaces = [&](std::size_t position) {
+            return std::min(line.find_first_not_of(" \t", position), line.size());
+        };
+
+        constexpr std::string_view key = "\"question\"";
+
+        if (auto found = line.find(key); found != std::string_view::npos)
+        {
+            auto before = line.find_last_not_of(" \t", found - 1);
+            auto colon = skipSpaces(found + key.size());
+            auto quote = colon < line.size() && line[colon] == ':' ? skipSpaces(colon + 1) : line.size();
+            auto end = quote < line.size() && line[quote] == '"' ? line.find_first_of("\"\\", quote + 1) : std::string_view::npos;
+
+            if ((line[before] == '{' || line[before] == ',') && end != std::string_view::npos && line[end] == '"')
+            {
+                return line.substr(quote + 1, end - quote - 1);
+            }
+        }
+
+        boost::system::error_code error;
+        auto record = boost::json::parse(line, error);
+        auto question = !error && record.is_object() ? record.as_object().if_contains("question") : nullptr;
+
+        if (question == nullptr || !question->is_string())
+        {
+            return std::nullopt;
+        }
+
+        return decoded.emplace_back(question->as_string());
+    }
+
+    MappedFile mapping;
+    std::vector<std::string_view> questionViews;
+
+    // Questions with escape sequences, decoded. A deque so the views stay valid as it grows.
+    std::deque<std::string> decoded;
+};
+
+#endif //MAGNUS_LIBER_BATCH_INPUT_HPP
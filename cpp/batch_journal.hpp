@@ -0,0 +1,114 @@
+#ifndef MAGNUS_LIBER_BATCH_JOURNAL_HPP
+#define MAGNUS_LIBER_BATCH_JOURNAL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Batch journals record how far a batch got, so it can be resumed after a crash without answering again the
+// questions already written. They hold a single record, replaced as the batch progresses:
+//
+//   [magic "MLBJRN02"][questionCount: uint64][completedCount: uint64][outputOffset: uint64]
+//   [retryCount: uint64][retryIndices: uint64 * retryCount]
+//
+// Results are written in the order of the questions, so the questions completed are the first `completedCount`
+// ones, and their results the first `outputOffset` bytes of the output. Questions among them that failed are
+// listed in `retryIndices` and answered again on resume; their new results are written after the others.
+
+constexpr auto BATCH_JOURNAL_EXTENSION = ".journal";
+constexpr char BATCH_JOURNAL_MAGIC[8] = { 'M', 'L', 'B', 'J', 'R', 'N', '0', '2' };
+
+struct BatchCheckpoint
+{
+    std::uint64_t questionCount;
+    std::uint64_t completedCount;
+    std::uint64_t outputOffset;
+
+    // Questions before `completedCount` still to answer
+    std::vector<std::uint64_t> retryIndices {};
+};
+
+// Read the last checkpoint of a journal, or nothing if there is no journal
+inline std::optional<BatchCheckpoint> readBatchCheckpoint(const std::string& path)
+{
+    auto file = std::fopen(path.c_str(), "rb");
+
+    if (file == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    char magic[sizeof(BATCH_JOURNAL_MAGIC)];
+    std::uint64_t header[4];
+    BatchCheckpoint checkpoint {};
+
+    auto valid = std::fread(magic, sizeof(magic), 1, file) == 1
+        && std::memcmp(magic, BATCH_JOURNAL_MAGIC, sizeof(magic)) == 0
+        && std::fread(header, sizeof(header), 1, file) == 1
+        && header[1] <= header[0]
+        && header[3] <= header[1];
+
+    if (valid)
+    {
+        checkpoint = { header[0], header[1], header[2], std::vector<std::uint64_t>(header[3]) };
+        valid = std::fread(checkpoint.retryIndices.data(), sizeof(std::uint64_t), header[3], file) == header[3];
+    }
+
+    std::fclose(file);
+
+    if (!valid || std::any_of(checkpoint.retryIndices.begin(), checkpoint.retryIndices.end(), [&](auto index) { return index >= checkpoint.completedCount; }))
+    {
+        throw std::runtime_error(path + " is not a valid batch journal");
+    }
+
+    return checkpoint;
+}
+
+// Replace the checkpoint of a journal. The new record is synced to disk and renamed over the old one, so the
+// journal always holds a whole checkpoint.
+inline void writeBatchCheckpoint(const std::string& path, const BatchCheckpoint& checkpoint)
+{
+    auto temporaryPath = path + ".tmp";
+    auto file = std::fopen(temporaryPath.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Failed to write " + temporaryPath);
+    }
+
+    std::uint64_t header[] = { checkpoint.questionCount, checkpoint.completedCount, checkpoint.outputOffset, checkpoint.retryIndices.size() };
+
+    auto written = std::fwrite(BATCH_JOURNAL_MAGIC, sizeof(BATCH_JOURNAL_MAGIC), 1, file) == 1
+        && std::fwrite(header, sizeof(header), 1, file) == 1
+        && std::fwrite(checkpoint.retryIndices.data(), sizeof(std::uint64_t), checkpoint.retryIndices.size(), file) == checkpoint.retryIndices.size()
+        && std::fflush(file) == 0;
+
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    ::fsync(fileno(file));
+#endif
+
+    std::fclose(file);
+
+    if (!written)
+    {
+        throw std::runtime_error("Failed to write " + temporaryPath);
+    }
+
+    std::filesystem::rename(temporaryPath, path);
+}
+
+#endif //MAGNUS_LIBER_BATCH_JOURNAL_HPP
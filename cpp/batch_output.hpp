@@ -0,0 +1,169 @@
+#ifndef MAGNUS_LIBER_BATCH_OUTPUT_HPP
+#define MAGNUS_LIBER_BATCH_OUTPUT_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// Records are written once this many bytes are waiting
+constexpr std::size_t BATCH_OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+// Writes the records of a batch to the standard output or a file.
+//
+// Records are kept as they were formatted and escaped by the threads that answered them, and written together
+// with a single `writev` once the buffer is full, rather than copied into a stream and flushed line by line.
+class BatchOutput
+{
+public:
+    // Write to the standard output
+    BatchOutput()
+        : descriptor(1), owned(false)
+    {
+    }
+
+    // Write to `path`, after its current content if `append` is set
+    BatchOutput(const std::string& path, bool append)
+        : owned(true)
+    {
+        auto flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+
+#ifdef _WIN32
+        descriptor = _open(path.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        descriptor = ::open(path.c_str(), flags, 0644);
+#endif
+
+        if (descriptor < 0)
+        {
+            throw std::runtime_error("Failed to open " + path);
+        }
+    }
+
+    BatchOutput(const BatchOutput&) = delete;
+    BatchOutput& operator=(const BatchOutput&) = delete;
+
+    ~BatchOutput()
+    {
+        try
+        {
+            flush();
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        if (owned)
+        {
+#ifdef _WIN32
+            _close(descriptor);
+#else
+            ::close(descriptor);
+#endif
+        }
+    }
+
+    void append(std::string record)
+    {
+        bufferedSize += record.size();
+        records.push_back(std::move(record));
+
+        if (bufferedSize >= BATCH_OUTPUT_BUFFER_SIZE)
+        {
+            flush();
+        }
+    }
+
+    // Write every record appended so far
+    void flush()
+    {
+#ifdef _WIN32
+        for (const auto& record : records)
+        {
+            for (std::size_t offset = 0; offset < record.size();)
+            {
+                auto written = _write(descriptor, record.data() + offset, static_cast<unsigned int>(record.size() - offset));
+
+                if (written < 0)
+                {
+                    throw std::runtime_error(std::string("Failed to write the batch output: ") + std::strerror(errno));
+                }
+
+                offset += static_cast<std::size_t>(written);
+            }
+        }
+#else
+#ifdef IOV_MAX
+        constexpr std::size_t maxVectors = IOV_MAX;
+#else
+        constexpr std::size_t maxVectors = 1024;
+#endif
+
+        std::vector<iovec> vectors;
+        vectors.reserve(std::min(records.size(), maxVectors));
+
+        for (std::size_t first = 0; first < records.size(); first += maxVectors)
+        {
+            vectors.clear();
+
+            for (auto i = first; i < std::min(first + maxVectors, records.size()); ++i)
+            {
+                vectors.push_back({ records[i].data(), records[i].size() });
+            }
+
+            // Resume after a partial write from the first record not completely written
+            for (auto next = vectors.begin(); next != vectors.end();)
+            {
+                auto written = ::writev(descriptor, &*next, static_cast<int>(vectors.end() - next));
+
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw std::runtime_error(std::string("Failed to write the batch output: ") + std::strerror(errno));
+                }
+
+                auto remaining = static_cast<std::size_t>(written);
+
+                for (; next != vectors.end() && remaining >= next->iov_len; ++next)
+                {
+                    remaining -= next->iov_len;
+                }
+
+                if (next != vectors.end())
+                {
+                    next->iov_base = static_cast<char*>(next->iov_base) + remaining;
+                    next->iov_len -= remaining;
+                }
+            }
+        }
+#endif
+
+        records.clear();
+        bufferedSize = 0;
+    }
+
+private:
+    int descriptor;
+    bool owned;
+
+    std::vector<std::string> records;
+    std::size_t bufferedSize = 0;
+};
+
+#endif //MAGNUS_LIBER_BATCH_OUTPUT_HPP
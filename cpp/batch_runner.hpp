@@ -0,0 +1,379 @@
+#ifndef MAGNUS_LIBER_BATCH_RUNNER_HPP
+#define MAGNUS_LIBER_BATCH_RUNNER_HPP
+
+#include "batch_output.hpp"
+#include "openai.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Results of a question ahead of the next one to write are held back at most this many questions per
+// concurrent request, so a single slow request cannot make the buffer grow without bound
+constexpr std::size_t REORDER_WINDOW_PER_REQUEST = 16;
+
+// How often the progress of a batch is reported for its journal
+constexpr auto BATCH_CHECKPOINT_INTERVAL = std::chrono::seconds(1);
+
+// Called with the number of questions whose results are written, the questions among them still to answer, and
+// the number of bytes written for them
+using BatchCheckpointer = std::function<void(std::size_t completedCount, std::span<const std::size_t> retryIndices, std::size_t writtenSize)>;
+
+// How the results of a batch are written
+enum class BatchFormat
+{
+    Text,       // The question, the answer and a blank line
+    JsonLines,  // A JSON object per line, with the usage and latency
+};
+
+// The answer to a question of a batch. Answers found locally have no finish reason or usage.
+struct BatchAnswer
+{
+    std::string text;
+    std::string finishReason {};
+    std::optional<TokenUsage> usage {};
+};
+
+// Format the result of `question`: its answer, or the `error` that prevented answering it
+inline std::string formatBatchRecord(BatchFormat format, std::string_view question, const BatchAnswer& answer, std::string_view error, double latency)
+{
+    std::string record;
+
+    if (format == BatchFormat::Text)
+    {
+        record.reserve(question.size() + answer.text.size() + error.size() + 16);
+        record += question;
+        record += '\n';
+        record += error.empty() ? std::string_view(answer.text) : std::string_view("Error: ");
+        record += error;
+        record += "\n\n";
+
+        return record;
+    }
+
+    record.reserve(question.size() + answer.text.size() + error.size() + 192);
+
+    record += "{\"question\":";
+    appendJsonString(record, question);
+
+    record += ",\"answer\":";
+
+    if (error.empty())
+    {
+        appendJsonString(record, answer.text);
+    }
+    else
+    {
+        record += "null";
+    }
+
+    record += ",\"usage\":";
+
+    if (answer.usage)
+    {
+        record += "{\"prompt_tokens\":" + std::to_string(answer.usage->promptTokens);
+        record += ",\"completion_tokens\":" + std::to_string(answer.usage->completionTokens);
+        record += ",\"total_tokens\":" + std::to_string(answer.usage->promptTokens + answer.usage->completionTokens) + "}";
+    }
+    else
+    {
+        record += "null";
+    }
+
+    appendJsonNumber(record, "latency_ms", latency);
+
+    record += ",\"finish_reason\":";
+
+    if (!answer.finishReason.empty())
+    {
+        appendJsonString(record, answer.finishReason);
+    }
+    else
+    {
+        record += "null";
+    }
+
+    if (!error.empty())
+    {
+        record += ",\"error\":";
+        appendJsonString(record, error);
+    }
+
+    record += "}\n";
+
+    return record;
+}
+
+// Writes the results of a batch in the order of the questions, whatever order they complete in.
+// Results are written for the questions of `retry`, then for the questions from `first` on. Positions count the
+// results in that order. `checkpoint` is called periodically with the progress.
+//
+// If the output or the checkpoint fails, nothing more is written and the error is kept for the caller, so the
+// journal still describes the output.
+class ReorderBuffer
+{
+public:
+    ReorderBuffer(BatchOutput& output, std::size_t window, std::span<const std::size_t> retry, std::size_t first, BatchCheckpointer checkpoint)
+        : output(output), window(window), retry(retry), first(first), checkpoint(std::move(checkpoint))
+    {
+    }
+
+    // Index of the question whose result is at `position`
+    std::size_t question(std::size_t position) const
+    {
+        return position < retry.size() ? retry[position] : first + position - retry.size();
+    }
+
+    // Wait until the result at `position` would be within the window of the next one to write.
+    // Returns false if results can no longer be written.
+    bool waitForTurn(std::size_t position)
+    {
+        std::unique_lock lock(mutex);
+        written.wait(lock, [&]() { return position < next + window || writeError; });
+
+        return !writeError;
+    }
+
+    // Hand over the result at `position`, which is an error if `failed`, and write every result now next in order
+    void complete(std::size_t position, std::string text, bool failed)
+    {
+        std::lock_guard lock(mutex);
+
+        if (writeError)
+        {
+            return;
+        }
+
+        pending.emplace(position, Result { std::move(text), failed });
+
+        try
+        {
+            auto wrote = false;
+
+            for (auto result = pending.begin(); result != pending.end() && result->first == next; result = pending.erase(result))
+            {
+                if (result->second.failed)
+                {
+                    failedIndices.push_back(question(next));
+                }
+
+                writtenSize += result->second.text.size();
+                output.append(std::move(result->second.text));
+                ++next;
+                wrote = true;
+            }
+
+            if (wrote)
+            {
+                written.notify_all();
+
+                // The results must reach the output before the journal says they are there
+                if (checkpoint && std::chrono::steady_clock::now() - lastCheckpoint >= BATCH_CHECKPOINT_INTERVAL)
+                {
+                    output.flush();
+                    report();
+                    lastCheckpoint = std::chrono::steady_clock::now();
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            fail(e);
+        }
+    }
+
+    // Write the results still buffered, and report the progress
+    void finish()
+    {
+        std::lock_guard lock(mutex);
+
+        if (writeError)
+        {
+            return;
+        }
+
+        try
+        {
+            output.flush();
+
+            if (checkpoint)
+            {
+                report();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            fail(e);
+        }
+    }
+
+    // Why results could no longer be written, if they could not
+    std::optional<std::string> error()
+    {
+        std::lock_guard lock(mutex);
+
+        return writeError;
+    }
+
+private:
+    struct Result
+    {
+        std::string text;
+        bool failed;
+    };
+
+    // Report the progress. The questions still to answer are the ones that failed, the ones to answer again that
+    // were not reached yet, and the ones not reached from `first` on.
+    void report()
+    {
+        auto retried = std::min(next, retry.size());
+
+        std::vector<std::size_t> retryIndices(failedIndices);
+        retryIndices.insert(retryIndices.end(), retry.begin() + retried, retry.end());
+
+        checkpoint(first + next - retried, retryIndices, writtenSize);
+    }
+
+    // Stop writing, and wake the threads waiting for their turn
+    void fail(const std::exception& e)
+    {
+        writeError = e.what();
+        pending.clear();
+        written.notify_all();
+    }
+
+    BatchOutput& output;
+    std::size_t window;
+    std::span<const std::size_t> retry;
+    std::size_t first;
+
+    std::mutex mutex;
+    std::condition_variable written;
+    std::map<std::size_t, Result> pending;
+    std::size_t next = 0;
+    std::size_t writtenSize = 0;
+    std::vector<std::size_t> failedIndices;
+    std::optional<std::string> writeError;
+
+    BatchCheckpointer checkpoint;
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+};
+
+struct BatchSummary
+{
+    std::size_t questionCount = 0;
+    std::size_t failedCount = 0;
+    std::chrono::duration<double> elapsed {};
+
+    // Why the results could not all be written, if they could not
+    std::optional<std::string> error;
+
+    // Time taken by each question, in milliseconds
+    std::vector<double> latencies;
+};
+
+// Print the throughput of a batch and the distribution of its latencies
+inline void printBatchSummary(std::ostream& out, BatchSummary summary)
+{
+    auto seconds = summary.elapsed.count();
+
+    out << "Batch: " << summary.questionCount - summary.failedCount << " of " << summary.questionCount << " questions answered in "
+        << seconds << " s (" << (seconds > 0.0 ? summary.questionCount / seconds : 0.0) << " questions/s)." << std::endl;
+
+    if (summary.latencies.empty())
+    {
+        return;
+    }
+
+    std::sort(summary.latencies.begin(), summary.latencies.end());
+
+    auto percentile = [&](double fraction) {
+        return summary.latencies[static_cast<std::size_t>(fraction * (summary.latencies.size() - 1))];
+    };
+
+    out << "Latency: p50 " << percentile(0.5) << " ms, p95 " << percentile(0.95) << " ms, p99 " << percentile(0.99)
+        << " ms, max " << summary.latencies.back() << " ms." << std::endl;
+}
+
+// Answer the questions of `retry`, then `questions` from `first` on, with `answer`, up to `concurrency` at a time,
+// and write the results to `output` in that order. `answer` takes a question and returns its BatchAnswer; it is
+// called from several threads at once, which also format the results. `checkpoint`, if set, is called
+// periodically and at the end with the progress.
+template<typename Answer>
+BatchSummary runBatch(std::span<const std::string_view> questions, std::span<const std::size_t> retry, std::size_t first, std::size_t concurrency, BatchFormat format, BatchOutput& output, Answer answer, BatchCheckpointer checkpoint = nullptr)
+{
+    concurrency = std::max<std::size_t>(concurrency, 1);
+    first = std::min(first, questions.size());
+
+    BatchSummary summary;
+    summary.questionCount = retry.size() + questions.size() - first;
+    summary.latencies.resize(summary.questionCount);
+
+    ReorderBuffer reorderBuffer(output, concurrency * REORDER_WINDOW_PER_REQUEST, retry, first, std::move(checkpoint));
+    std::atomic<std::size_t> nextPosition = 0;
+    std::atomic<std::size_t> failed = 0;
+
+    auto work = [&]() {
+        for (auto position = nextPosition++; position < summary.questionCount; position = nextPosition++)
+        {
+            if (!reorderBuffer.waitForTurn(position))
+            {
+                return;
+            }
+
+            auto index = reorderBuffer.question(position);
+            auto start = std::chrono::steady_clock::now();
+            BatchAnswer result;
+            std::string error;
+
+            try
+            {
+                result = answer(questions[index]);
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+                ++failed;
+            }
+
+            auto latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            summary.latencies[position] = latency;
+
+            reorderBuffer.complete(position, formatBatchRecord(format, questions[index], result, error, latency), !error.empty());
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        std::vector<std::jthread> workers;
+
+        for (std::size_t i = 0; i < std::min(concurrency, summary.questionCount); ++i)
+        {
+            workers.emplace_back(work);
+        }
+    }
+
+    reorderBuffer.finish();
+
+    summary.elapsed = std::chrono::steady_clock::now() - start;
+    summary.failedCount = failed;
+    summary.error = reorderBuffer.error();
+
+    return summary;
+}
+
+#endif //MAGNUS_LIBER_BATCH_RUNNER_HPP
@@ -0,0 +1,167 @@
+// Recall and latency of the HNSW index behind the semantic cache, against an exhaustive search.
+//
+// Usage: SemanticCacheBench [<vectors> [<dimensions> [<queries>]]]
+//
+// Vectors are drawn around random cluster centres, like embeddings of questions about a few hundred
+// emperors, and normalised. Build with optimisations, and `-march=native` to measure the AVX2 kernel.
+
+#include "../hnsw_index.hpp"
+#include "../vector_math.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t CLUSTER_COUNT = 200;
+    constexpr std::size_t NEIGHBOUR_COUNT = 10;
+    constexpr std::size_t BREADTHS[] = { 16, 32, 64, 128, 256 };
+
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMicroseconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // `count` unit vectors around random cluster centres
+    std::vector<float> makeVectors(std::size_t count, std::size_t dimensions, const std::vector<float>& centres, std::mt19937& random)
+    {
+        std::normal_distribution<float> noise(0.0f, 0.6f);
+        std::uniform_int_distribution<std::size_t> cluster(0, CLUSTER_COUNT - 1);
+        std::vector<float> vectors(count * dimensions);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto vector = std::span(vectors).subspan(i * dimensions, dimensions);
+            auto centre = std::span(centres).subspan(cluster(random) * dimensions, dimensions);
+
+            for (std::size_t d = 0; d < dimensions; ++d)
+            {
+                vector[d] = centre[d] + noise(random) / std::sqrt(static_cast<float>(dimensions));
+            }
+
+            normalise(vector);
+        }
+
+        return vectors;
+    }
+
+    // Identifiers of the `count` vectors most similar to `query`, found by comparing it with all of them
+    std::vector<std::uint32_t> exactNeighbours(std::span<const float> vectors, std::size_t dimensions, std::span<const float> query, std::size_t count)
+    {
+        std::vector<HnswIndex::Match> matches(vectors.size() / dimensions);
+
+        for (std::size_t i = 0; i < matches.size(); ++i)
+        {
+            matches[i] = { dotProduct(vectors.subspan(i * dimensions, dimensions), query), static_cast<std::uint32_t>(i) };
+        }
+
+        std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), std::greater<>());
+
+        std::vector<std::uint32_t> identifiers;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            identifiers.push_back(matches[i].second);
+        }
+
+        return identifiers;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t vectorCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::size_t dimensions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1536;
+    std::size_t queryCount = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 500;
+
+    if (vectorCount < NEIGHBOUR_COUNT || dimensions == 0 || queryCount == 0)
+    {
+        std::cerr << "Usage: SemanticCacheBench [<vectors> [<dimensions> [<queries>]]]" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 random(42);
+    std::normal_distribution<float> coordinate;
+    std::vector<float> centres(CLUSTER_COUNT * dimensions);
+
+    for (auto& value : centres)
+    {
+        value = coordinate(random);
+    }
+
+    for (std::size_t i = 0; i < CLUSTER_COUNT; ++i)
+    {
+        normalise(std::span(centres).subspan(i * dimensions, dimensions));
+    }
+
+    auto vectors = makeVectors(vectorCount, dimensions, centres, random);
+    auto queries = makeVectors(queryCount, dimensions, centres, random);
+
+    // Kernel
+    {
+        constexpr std::size_t repetitions = 100000;
+        auto a = std::span<const float>(vectors).first(dimensions);
+        auto b = std::span<const float>(vectors).subspan(dimensions, dimensions);
+        volatile float sink = 0.0f;
+
+        auto start = Clock::now();
+
+        for (std::size_t i = 0; i < repetitions; ++i)
+        {
+            sink = sink + dotProduct(a, b);
+        }
+
+        std::cout << "dotProduct over " << dimensions << " floats: " << elapsedMicroseconds(start) * 1000.0 / repetitions << " ns" << std::endl;
+    }
+
+    // Index construction
+    HnswIndex index(dimensions);
+    auto start = Clock::now();
+
+    for (std::size_t i = 0; i < vectorCount; ++i)
+    {
+        index.add(std::span<const float>(vectors).subspan(i * dimensions, dimensions));
+    }
+
+    std::cout << "Built an index of " << vectorCount << " vectors in " << elapsedMicroseconds(start) / 1e6 << " s" << std::endl;
+
+    // Exhaustive search, which gives the true neighbours
+    std::vector<std::vector<std::uint32_t>> truth;
+    start = Clock::now();
+
+    for (std::size_t q = 0; q < queryCount; ++q)
+    {
+        truth.push_back(exactNeighbours(vectors, dimensions, std::span<const float>(queries).subspan(q * dimensions, dimensions), NEIGHBOUR_COUNT));
+    }
+
+    std::cout << "Exhaustive: " << elapsedMicroseconds(start) / 1000.0 / queryCount << " ms per search" << std::endl;
+
+    // Approximate search at increasing breadths
+    for (auto breadth : BREADTHS)
+    {
+        std::size_t found = 0;
+        start = Clock::now();
+
+        for (std::size_t q = 0; q < queryCount; ++q)
+        {
+            for (auto [similarity, identifier] : index.search(std::span<const float>(queries).subspan(q * dimensions, dimensions), NEIGHBOUR_COUNT, breadth))
+            {
+                found += std::count(truth[q].begin(), truth[q].end(), identifier);
+            }
+        }
+
+        auto milliseconds = elapsedMicroseconds(start) / 1000.0 / queryCount;
+
+        std::cout << "HNSW ef=" << breadth << ": recall@" << NEIGHBOUR_COUNT << " " << static_cast<double>(found) / (queryCount * NEIGHBOUR_COUNT)
+                  << ", " << milliseconds << " ms per search" << std::endl;
+    }
+}
@@ -0,0 +1,178 @@
+// Throughput of searches split between the threads of a ThreadPool, against starting threads for every search
+// as the vector store did before the pool.
+//
+// Usage: ThreadPoolBench [<vectors> [<dimensions> [<queries>]]]
+//
+// Each search compares a query with every vector, in one slice per thread, like VectorStore::search. The
+// overhead of handing out an empty loop is measured as well, which is what small stores and nested loops pay.
+
+#include "../thread_pool.hpp"
+#include "../vector_math.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t NEIGHBOUR_COUNT = 10;
+    constexpr std::size_t EMPTY_LOOPS = 10000;
+
+    using Clock = std::chrono::steady_clock;
+    using Match = std::pair<float, std::uint32_t>;
+
+    double elapsedMicroseconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // Best matches of `query` among the vectors of slice `slice` of `sliceCount`
+    std::vector<Match> searchSlice(std::span<const float> vectors, std::size_t dimensions, std::span<const float> query, std::size_t slice, std::size_t sliceCount)
+    {
+        auto count = vectors.size() / dimensions;
+        std::priority_queue<Match, std::vector<Match>, std::greater<>> best;
+
+        for (auto i = count * slice / sliceCount; i < count * (slice + 1) / sliceCount; ++i)
+        {
+            auto similarity = dotProduct(query.data(), vectors.data() + i * dimensions, dimensions);
+
+            if (best.size() < NEIGHBOUR_COUNT)
+            {
+                best.emplace(similarity, static_cast<std::uint32_t>(i));
+            }
+            else if (similarity > best.top().first)
+            {
+                best.pop();
+                best.emplace(similarity, static_cast<std::uint32_t>(i));
+            }
+        }
+
+        std::vector<Match> matches;
+
+        for (; !best.empty(); best.pop())
+        {
+            matches.push_back(best.top());
+        }
+
+        return matches;
+    }
+
+    // Run `fanOut(sliceCount, searchSlice)` for every query and return the searches per second
+    template<typename FanOut>
+    double measure(std::span<const float> vectors, std::span<const float> queries, std::size_t dimensions, std::size_t sliceCount, FanOut fanOut, std::size_t& checksum)
+    {
+        std::vector<std::vector<Match>> sliceMatches(sliceCount);
+        auto queryCount = queries.size() / dimensions;
+        auto start = Clock::now();
+
+        for (std::size_t q = 0; q < queryCount; ++q)
+        {
+            auto query = queries.subspan(q * dimensions, dimensions);
+
+            fanOut(sliceCount, [&](std::size_t slice) {
+                sliceMatches[slice] = searchSlice(vectors, dimensions, query, slice, sliceCount);
+            });
+
+            for (const auto& matches : sliceMatches)
+            {
+                checksum += matches.empty() ? 0 : matches.back().second;
+            }
+        }
+
+        return queryCount / (elapsedMicroseconds(start) / 1e6);
+    }
+
+    // The search before the pool: a thread started for every slice but the first, which the caller searches
+    void startThreads(std::size_t count, const std::function<void(std::size_t)>& function)
+    {
+        std::vector<std::jthread> threads;
+
+        for (std::size_t i = 1; i < count; ++i)
+        {
+            threads.emplace_back(function, i);
+        }
+
+        function(0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t vectorCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 65536;
+    std::size_t dimensions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 384;
+    std::size_t queryCount = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 200;
+
+    if (vectorCount == 0 || dimensions == 0 || queryCount == 0)
+    {
+        std::cerr << "Usage: ThreadPoolBench [<vectors> [<dimensions> [<queries>]]]" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 random(42);
+    std::normal_distribution<float> coordinate;
+    std::vector<float> vectors(vectorCount * dimensions);
+    std::vector<float> queries(queryCount * dimensions);
+
+    for (auto& value : vectors)
+    {
+        value = coordinate(random);
+    }
+
+    for (auto& value : queries)
+    {
+        value = coordinate(random);
+    }
+
+    std::cout << std::thread::hardware_concurrency() << " cores, " << vectorCount << " vectors of " << dimensions << " dimensions, "
+              << queryCount << " searches" << std::endl;
+
+    // Both sides find the same matches, so the checksums must agree
+    std::size_t poolChecksum = 0;
+    std::size_t threadChecksum = 0;
+
+    for (std::size_t threadCount = 1; threadCount <= std::max(8u, 2 * std::thread::hardware_concurrency()); threadCount *= 2)
+    {
+        ThreadPool threadPool(threadCount);
+
+        auto pooled = measure(vectors, queries, dimensions, threadCount, [&](std::size_t count, const auto& function) {
+            threadPool.parallelFor(count, function);
+        }, poolChecksum);
+
+        auto started = measure(vectors, queries, dimensions, threadCount, startThreads, threadChecksum);
+
+        // Overhead of a loop of one empty task per thread
+        auto start = Clock::now();
+
+        for (std::size_t i = 0; i < EMPTY_LOOPS; ++i)
+        {
+            threadPool.parallelFor(threadCount, [](std::size_t) {});
+        }
+
+        auto pooledOverhead = elapsedMicroseconds(start) / EMPTY_LOOPS;
+        start = Clock::now();
+
+        for (std::size_t i = 0; i < EMPTY_LOOPS; ++i)
+        {
+            startThreads(threadCount, [](std::size_t) {});
+        }
+
+        auto startedOverhead = elapsedMicroseconds(start) / EMPTY_LOOPS;
+
+        std::cout << threadCount << " threads: pool " << pooled << " searches/s, " << pooledOverhead << " us per empty loop; started threads "
+                  << started << " searches/s, " << startedOverhead << " us per empty loop" << std::endl;
+    }
+
+    if (poolChecksum != threadChecksum)
+    {
+        std::cerr << "Error: The pool and the started threads found different matches" << std::endl;
+        return 1;
+    }
+}
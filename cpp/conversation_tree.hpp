@@ -0,0 +1,357 @@
+#ifndef MAGNUS_LIBER_CONVERSATION_TREE_HPP
+#define MAGNUS_LIBER_CONVERSATION_TREE_HPP
+
+#include "message_codec.hpp"
+#include "openai.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The chat history of every branch of a conversation.
+//
+// Each message is a node that points at the message before it, so a branch is just the node at its tip
+// and branches share every message they have in common. Messages are never modified once created.
+//
+// Nodes are stored as a structure of arrays. The text of every message lives in one contiguous arena,
+// next to the message already converted to JSON, so a conversation is serialised by copying bytes that
+// were escaped once when the message was added.
+//
+// Messages outside the current branch are cold: they are compressed until the branch they belong to is
+// switched to again, and messages no branch uses any more are freed.
+//
+// Views returned by the tree are invalidated when a message is added or the tree is compressed.
+class ConversationTree
+{
+public:
+    static constexpr std::uint32_t NO_NODE = UINT32_MAX;
+    static constexpr auto DEFAULT_BRANCH = "main";
+
+    ConversationTree()
+    {
+        branches[DEFAULT_BRANCH] = NO_NODE;
+    }
+
+    // Number of messages in the current branch
+    std::size_t size() const
+    {
+        return tip() == NO_NODE ? 0 : depths[tip()];
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // Append a message to the current branch
+    void push(Role role, std::string_view content)
+    {
+        auto contentOffset = static_cast<std::uint32_t>(arena.size());
+        arena.append(content);
+
+        auto jsonOffset = static_cast<std::uint32_t>(arena.size());
+        appendMessageJson(arena, { role, content });
+
+        addNode(tip(), role, contentOffset, static_cast<std::uint32_t>(content.size()), jsonOffset, static_cast<std::uint32_t>(arena.size() - jsonOffset));
+    }
+
+    // Append views of the messages of the current branch to `conversation`, oldest first
+    void appendTo(std::vector<ChatMessageView>& conversation) const
+    {
+        for (auto node : path())
+        {
+            conversation.push_back({ roles[node], std::string_view(arena).substr(contentOffsets[node], contentLengths[node]) });
+        }
+    }
+
+    // Append the JSON of the messages of the current branch to `messagesJson`, oldest first
+    void appendJsonTo(std::vector<std::string_view>& messagesJson) const
+    {
+        for (auto node : path())
+        {
+            messagesJson.push_back(std::string_view(arena).substr(jsonOffsets[node], jsonLengths[node]));
+        }
+    }
+
+    // Remove the oldest `count` messages of the current branch
+    void eraseFront(std::size_t count)
+    {
+        relink(count, NO_NODE);
+    }
+
+    // Replace the oldest `count` messages of the current branch with a single message
+    void replaceFront(std::size_t count, Role role, std::string_view content)
+    {
+        auto branchTip = tip();
+
+        // Start a new root for the message...
+        tip() = NO_NODE;
+        push(role, content);
+        auto root = tip();
+
+        // ...and reattach the remaining messages to it
+        tip() = branchTip;
+        relink(count, root);
+    }
+
+    const std::string& currentBranch() const
+    {
+        return branch;
+    }
+
+    // Create a branch named `name` at the tip of the current branch and switch to it.
+    // Returns false if the branch already exists.
+    bool fork(const std::string& name)
+    {
+        if (!branches.emplace(name, tip()).second)
+        {
+            return false;
+        }
+
+        branch = name;
+
+        return true;
+    }
+
+    // Make `name` the current branch. Returns false if there is no such branch.
+    bool switchTo(const std::string& name)
+    {
+        if (!branches.contains(name))
+        {
+            return false;
+        }
+
+        branch = name;
+        decompressBranch();
+
+        return true;
+    }
+
+    // Compress the messages of other branches and free the messages no branch uses any more.
+    // Only does the work once they take more than half of the arena, so the cost is amortised over the turns
+    // that added them.
+    void compressCold()
+    {
+        auto hotPath = path();
+        std::size_t hotBytes = 0;
+
+        for (auto node : hotPath)
+        {
+            hotBytes += contentLengths[node] + jsonLengths[node];
+        }
+
+        if (arena.size() - hotBytes < std::max(arena.size() / 2, MIN_COLD_BYTES))
+        {
+            return;
+        }
+
+        // Find which nodes are used by the current branch (hot), by another branch (cold) or by none
+        enum : std::uint8_t { UNUSED, COLD, HOT };
+        std::vector<std::uint8_t> temperatures(parents.size(), UNUSED);
+
+        for (const auto& [name, branchTip] : branches)
+        {
+            for (auto node = branchTip; node != NO_NODE && temperatures[node] == UNUSED; node = parents[node])
+            {
+                temperatures[node] = COLD;
+            }
+        }
+
+        for (auto node : hotPath)
+        {
+            temperatures[node] = HOT;
+        }
+
+        // Rebuild both arenas. Nodes may share text, so each piece is moved once and looked up by its old offset.
+        // Text and JSON have maps of their own: empty text starts at the same offset as its JSON.
+        std::string hotArena;
+        std::string coldArena;
+        using MovedOffsets = std::unordered_map<std::uint32_t, std::pair<std::uint32_t, std::uint32_t>>;
+        MovedOffsets movedText;
+        MovedOffsets movedJson;
+        MovedOffsets movedFrames;
+        MovedOffsets compressedText;
+
+        auto move = [](MovedOffsets& moved, std::uint32_t& offset, std::uint32_t& length, auto store) {
+            auto [entry, added] = moved.try_emplace(offset);
+
+            if (added)
+            {
+                entry->second = store(offset, length);
+            }
+
+            std::tie(offset, length) = entry->second;
+        };
+
+        auto keep = [](std::string& to, const std::string& from) {
+            return [to = &to, from = &from](std::uint32_t offset, std::uint32_t length) {
+                auto newOffset = static_cast<std::uint32_t>(to->size());
+                to->append(*from, offset, length);
+
+                return std::pair(newOffset, length);
+            };
+        };
+
+        auto compress = [&](std::uint32_t offset, std::uint32_t length) {
+            auto newOffset = static_cast<std::uint32_t>(coldArena.size());
+            codec.compress(std::string_view(arena).substr(offset, length), coldArena);
+
+            return std::pair(newOffset, static_cast<std::uint32_t>(coldArena.size() - newOffset));
+        };
+
+        for (std::size_t node = 0; node < parents.size(); ++node)
+        {
+            if (temperatures[node] == UNUSED)
+            {
+                compressed[node] = false;
+                contentLengths[node] = 0;
+                jsonLengths[node] = 0;
+            }
+            else if (compressed[node])
+            {
+                move(movedFrames, contentOffsets[node], contentLengths[node], keep(coldArena, compressedArena));
+            }
+            else if (temperatures[node] == HOT)
+            {
+                move(movedText, contentOffsets[node], contentLengths[node], keep(hotArena, arena));
+                move(movedJson, jsonOffsets[node], jsonLengths[node], keep(hotArena, arena));
+            }
+            else
+            {
+                // The JSON is rebuilt from the text when the message is decompressed
+                move(compressedText, contentOffsets[node], contentLengths[node], compress);
+                compressed[node] = true;
+                jsonLengths[node] = 0;
+            }
+        }
+
+        arena = std::move(hotArena);
+        compressedArena = std::move(coldArena);
+        arena.shrink_to_fit();
+        compressedArena.shrink_to_fit();
+    }
+
+    // Name of every branch
+    std::vector<std::string> branchNames() const
+    {
+        std::vector<std::string> names;
+
+        for (const auto& [name, node] : branches)
+        {
+            names.push_back(name);
+        }
+
+        return names;
+    }
+
+private:
+    std::uint32_t& tip()
+    {
+        return branches[branch];
+    }
+
+    std::uint32_t tip() const
+    {
+        return branches.at(branch);
+    }
+
+    void addNode(std::uint32_t parent, Role role, std::uint32_t contentOffset, std::uint32_t contentLength, std::uint32_t jsonOffset, std::uint32_t jsonLength)
+    {
+        parents.push_back(parent);
+        depths.push_back(parent == NO_NODE ? 1 : depths[parent] + 1);
+        roles.push_back(role);
+        contentOffsets.push_back(contentOffset);
+        contentLengths.push_back(contentLength);
+        jsonOffsets.push_back(jsonOffset);
+        jsonLengths.push_back(jsonLength);
+        compressed.push_back(false);
+
+        tip() = static_cast<std::uint32_t>(parents.size() - 1);
+    }
+
+    // Nodes of the current branch, oldest first
+    std::vector<std::uint32_t> path() const
+    {
+        std::vector<std::uint32_t> nodes(size());
+
+        for (auto node = tip(), i = static_cast<std::uint32_t>(nodes.size()); node != NO_NODE; node = parents[node])
+        {
+            nodes[--i] = node;
+        }
+
+        return nodes;
+    }
+
+    // Decompress the messages of the current branch
+    void decompressBranch()
+    {
+        for (auto node : path())
+        {
+            if (!compressed[node])
+            {
+                continue;
+            }
+
+            auto frame = std::string_view(compressedArena).substr(contentOffsets[node], contentLengths[node]);
+
+            contentOffsets[node] = static_cast<std::uint32_t>(arena.size());
+            codec.decompress(frame, arena);
+            contentLengths[node] = static_cast<std::uint32_t>(arena.size() - contentOffsets[node]);
+
+            // The JSON is built from the text in the arena itself, so the arena must not grow while it is built.
+            // Escaping at most turns each byte into "\u00XX".
+            arena.reserve(arena.size() + contentLengths[node] * 6 + 64);
+
+            jsonOffsets[node] = static_cast<std::uint32_t>(arena.size());
+            appendMessageJson(arena, { roles[node], std::string_view(arena).substr(contentOffsets[node], contentLengths[node]) });
+            jsonLengths[node] = static_cast<std::uint32_t>(arena.size() - jsonOffsets[node]);
+
+            compressed[node] = false;
+        }
+    }
+
+    // Rebuild the current branch on top of `root`, skipping its oldest `count` messages.
+    // The new nodes share the text of the old ones, and other branches keep the old nodes.
+    void relink(std::size_t count, std::uint32_t root)
+    {
+        auto nodes = path();
+
+        tip() = root;
+
+        for (auto i = std::min(count, nodes.size()); i < nodes.size(); ++i)
+        {
+            auto node = nodes[i];
+
+            addNode(tip(), roles[node], contentOffsets[node], contentLengths[node], jsonOffsets[node], jsonLengths[node]);
+        }
+    }
+
+    // Cold text is only compressed once there is at least this much of it
+    static constexpr std::size_t MIN_COLD_BYTES = 32 * 1024;
+
+    // Nodes. The text of compressed nodes is a frame in `compressedArena` and they have no JSON.
+    std::vector<std::uint32_t> parents;
+    std::vector<std::uint32_t> depths;
+    std::vector<Role> roles;
+    std::vector<std::uint32_t> contentOffsets;
+    std::vector<std::uint32_t> contentLengths;
+    std::vector<std::uint32_t> jsonOffsets;
+    std::vector<std::uint32_t> jsonLengths;
+    std::vector<bool> compressed;
+
+    // Text and JSON of the messages, and compressed text of the cold ones
+    std::string arena;
+    std::string compressedArena;
+    MessageCodec codec;
+
+    // Tip of each branch
+    std::map<std::string, std::uint32_t> branches;
+    std::string branch = DEFAULT_BRANCH;
+};
+
+#endif //MAGNUS_LIBER_CONVERSATION_TREE_HPP
@@ -0,0 +1,67 @@
+#ifndef MAGNUS_LIBER_DOMAIN_CLASSIFIER_HPP
+#define MAGNUS_LIBER_DOMAIN_CLASSIFIER_HPP
+
+#include "domain_model.hpp"
+#include "emperor_index.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// FNV-1a hash of `bytes`, starting from `hash`
+inline std::uint32_t fnv1a(std::string_view bytes, std::uint32_t hash = 2166136261u)
+{
+    for (auto c : bytes)
+    {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Probability that `question` is not about Roman and Byzantine rulers, from the linear model of domain_model.hpp.
+// The features are the hashed character 3-grams and 4-grams and the hashed words of the normalised question,
+// computed exactly as tools/train_domain_model.py does.
+inline float outOfDomainProbability(std::string_view question)
+{
+    auto padded = " " + normaliseName(question) + " ";
+    auto text = std::string_view(padded);
+
+    std::int32_t sum = 0;
+    std::size_t count = 0;
+
+    auto add = [&](std::uint32_t hash) {
+        sum += DOMAIN_MODEL_WEIGHTS[hash & (DOMAIN_MODEL_BUCKET_COUNT - 1)];
+        ++count;
+    };
+
+    for (std::size_t length = 3; length <= 4; ++length)
+    {
+        for (std::size_t i = 0; i + length <= text.size(); ++i)
+        {
+            add(fnv1a(text.substr(i, length)));
+        }
+    }
+
+    // Words are prefixed with a byte that never appears in the text, so they do not collide with n-grams
+    for (std::size_t start = 1; start + 1 < text.size();)
+    {
+        auto end = text.find(' ', start);
+        add(fnv1a(text.substr(start, end - start), fnv1a("\x01")));
+        start = end + 1;
+    }
+
+    auto score = DOMAIN_MODEL_BIAS + (count == 0 ? 0.0f : static_cast<float>(sum) * DOMAIN_MODEL_SCALE / std::sqrt(static_cast<float>(count)));
+
+    return 1.0f / (1.0f + std::exp(-score));
+}
+
+// True if `question` is clearly not about Roman and Byzantine rulers, so it can be refused without asking OpenAI.
+// The threshold is high: a question that is only possibly off-topic is still sent.
+inline bool isOutOfDomain(std::string_view question)
+{
+    return outOfDomainProbability(question) >= DOMAIN_MODEL_THRESHOLD;
+}
+
+#endif //MAGNUS_LIBER_DOMAIN_CLASSIFIER_HPP
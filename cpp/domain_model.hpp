@@ -0,0 +1,274 @@
+#ifndef MAGNUS_LIBER_DOMAIN_MODEL_HPP
+#define MAGNUS_LIBER_DOMAIN_MODEL_HPP
+
+// Generated by tools/train_domain_model.py from tools/domain_questions.txt. Do not edit.
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr std::size_t DOMAIN_MODEL_BUCKET_COUNT = 4096;
+constexpr float DOMAIN_MODEL_BIAS = -0.215975f;
+constexpr float DOMAIN_MODEL_SCALE = 0.03138312f;
+constexpr float DOMAIN_MODEL_THRESHOLD = 0.9f;
+
+// Weight of each feature bucket, multiplied by DOMAIN_MODEL_SCALE
+constexpr std::int8_t DOMAIN_MODEL_WEIGHTS[DOMAIN_MODEL_BUCKET_COUNT] = {
+      -7,  -10,    0,   -6,    0,   11,   -6,   -1,    0,   -1,   -5,   14,   19,    0,   -2,    4,
+      22,    0,   -2,   12,    7,   -4,    0,   22,    8,    0,    3,    0,   10,   17,    0,  -13,
+      11,    0,   -3,    0,    0,    2,    0,    2,    0,    6,    6,   -7,    9,  -19,    8,   -1,
+       0,    0,    1,   -2,   -6,    0,    0,   11,   11,   -1,    0,    3,    1,    5,   -3,   -5,
+       2,    0,    0,   23,  -22,   -1,   51,    0,    0,   -3,    4,   34,   22,   21,  -23,    0,
+      -5,   -1,   -4,   -4,    2,   12,  -41, -113,   -2,    2,    3,   -2,  -14,  -17,    0,    5,
+     -19,    9,   15,   30,   27,    0,    0,    2,   24,    5,   -8,  -19,   15,  -13,    0,   82,
+      -7,    0,    0,    0,    0,   21,    0,    0,    0,   -9,    0,   25,   11,   13,    6,    3,
+       4,  -13,   12,   -4,   -4,   44,    2,    3,    4,    3,    7,   10,    3,    0,   -6,    7,
+      17,    0,    9,    4,   -8,    5,    0,  -21,  -39,    6,  -14,  -14,    7,   34,  -15,   10,
+      -3,    0,  -11,   -2,    0,   15,   -8,    0,    0,    7,    0,    6,    5,    0,   62,    8,
+       6,   -1,   16,    2,    0,    0,   -7,   10,   14,   -3,    3,    2,   -3,    1,    0,  -26,
+       6,    1,    0,    0,  -13,   -2,    0,    3,    0,   14,    8,  -24,   13,  -26,   -5,   -7,
+      -5,    5,    0,  -27,   14,    1,    3,    6,    0,   -2,    2,   20,   34,    5,    8,   23,
+      -3,   16,   -4,   -9,   -5,    0,    6,    2,   13,    4,    6,    0,   25,    7,   -7,    0,
+     -15,  -12,  -16,    0,    6,    4,   -6,    2,  -11,   10,    6,    0,   16,    0,    0,  -31,
+      12,    0,   -8,    0,    7,    0,   23,    2,   -3,   -8,    6,  -10,   -9,    0,    6,   -7,
+       0,    0,    2,    7,  -56,  -20,  -20,    0,   -5,    4,   -2,  -12,   20,    4,  -11,   22,
+       0,    0,   -5,  -31,    0,   -4,  -15,   -4,    0,   12,    0,   -5,  -27,    0,   22,   -1,
+     -11,    0,  -12,   15,   -7,    0,    0,    0,  -16,    1,    3,    9,   -1,    1,    0,    2,
+      -3,  -16,    2,  -49,   14,  -11,    5,    0,   -4,    0,  -10,  -25,    4,   -3,    0,    0,
+       0,    3,   -6,   -2,    0,    0,   -8,   -3,   21,    0,    0,  -32,  -12,   -9,    6,   -5,
+       6,   -3,    0,  -10,    0,    2,    9,  -22,    0,    5,    0,  -22,    1,   -3,    2,   -4,
+      -4,   -7,    3,    8,  -29,    0,  -24,    0,    3,    0,   -4,  -35,    0,  -21,    0,    0,
+       2,    0,    0,    0,  -10,    8,   11,    0,   12,   -5,    0,    0,   -1,   -1,   29,   38,
+      12,    0,    4,    1,   -2,  -28,    0,    6,    5,    6,    0,   -1,    4,   -5,    0,   -6,
+       0,    0,   10,  -10,    0,  -19,  -43,  -10,    1,   -5,   -1,   -4,    5,    0,    0,  -15,
+      -2,    0,  -14,   -2,    0,    3,   -7,   10,    0,   -6,  -14,  -49,   -7,    0,    0,    5,
+     -14,   -6,    4,    0,    0,   -8,    4,    9,  -10, -100,    1,    5,  -13,    0,    2,    3,
+     -16,    0,    0,   -3,   13,  -12,  -14,   -2,    5,    0,  -17,    0,   -7,   17,  -14,   -9,
+      -8,   -1,    0,   -2,    0,    2,    4,   12,    0,   -2,    0,   23,    2,   -1,    0,   18,
+      -5,  -46, -100,    0,   -1,    2,    0,    5,    0,    6,   11,    0,    2,   11,    0,   -8,
+       0,   11,    1,    0,   -3,    0,    0,    9,   12,   -1,   -1,    3,    2,    0,   -3,   17,
+      -8,   -1,    5,    1,   11,   44,   27,    1,    7,   10,    4,    5,   41,    1,    3,   -4,
+      -4,  -15,   18,   -9,    0,   -6,    0,   10,   29,    7,    1,    6,    0,    4,   -1,  -16,
+       5,   -2,    0,    2,  -65,    0,    2,  -11,  -99,   89,   -1,   10,  -10,    1,    9,   14,
+       0,   16,   -3,    8,    0,    1,    0,   -5,    3,   -3,    4,   -2,    9,    3,    2,    0,
+       8,   -5,    2,    3,  -23,  -13,   -6,   15,   -5,    7,   -1,   -4,   -2,   -2,   34,    6,
+      18,    5,  -15,    1,    0,    3,    2,    7,   24,  -24,    3,    5,    2,  -14,   37,   -8,
+      -1,   -1,   10,   -7,   10,    0,    0,    0,    8,   -1,    4,    0,    1,    2,   -3,   21,
+      -4,    6,    6,   -3,  -52,   -7,    2,    8,  -23,   -1,    2,   -2,   -6,   -7,    2,    2,
+      -9,    0,    2,    0,    0,   32,    0,  -10,  -27,    4,    0,    0,    8,    0,    1,   12,
+       2,   22,    0,   13,    2,  -13,  -20,  -11,  -13,    0,   -3,    0,   -1,   -7,    6,   12,
+      -7,   -8,    9,   -6,   15,    0,   -5,   -6,   11,    0,    5,    0,    6,    2,    0,  -29,
+       5,    8,   13,  -20,    0,   -4,   13,  -39,    0,    1,    7,    0,  -28,    0,    3,  -36,
+       0,    0,   -3,    5,    1,  -14,   -1,   24,    3,    0,   -1,   -1,    6,   18,    7,    2,
+       1,  -14,    5,    3,    7,    8,   19,    2,   -1,    8,    2,   16,   14,    3,    0,    0,
+      11,  -29,    0,   -4,   11,   47,   16,    1,  -20,  -13,    4, -112,    8,    0,    9,    0,
+      -2,   27,   14,   -3,    2,    0,   11,    9,   20,    0,    0,   11,   10,   -2,    0,   -2,
+       5,    0,   -2,    5,    1,    0,  -12,    4,    0,   -2,    0,   -7,    0,    0,    0,    6,
+       0,   -1,    7,    0,    4,    0,   -8,    6,   26,    9,    3,   -6,    8,   -8,   -3,   25,
+       0,    0,    0,    0,    2,    0,   -8,   -1,  -11,   -3,    0,   -4,   -5,   17,    0,   -9,
+     -13,    0,    6,    8,  -29,   -2,    0,   13,   12,    8,    0,    0,    0,   11,    0,    0,
+       0,    0,    0,    3,   -3,    5,    7,    2,    3,    0,    4,  -12,    7,   10,   21,    0,
+      -5,   33,   15,   -1,   31,   -2,    2,   23,    8,    9,   -3,    2,    0,  -12,    0,    0,
+       7,   11,    8,   13,  -11,    0,    9,    0,   -1,   13,   22,  -14,    0,   -8,   29,   -4,
+       0,   -1,   -2,    0,   -1,  -12,  -13,    0,    0,   14,   14,    0,   -4,    0,    2,   -5,
+     -22,    4,  -13,    0,   -9,    4,   -7,   -2,  -34,    4,    5,   20,    9,   27,   -8,    1,
+     -10,   15,    0,   16,   -3,   28,   11,    0,   -3,    6,    1,   -6,   -2,   13,   -4,  -12,
+       0,   -8,    9,   13,    3,    2,    2,    1,    0,   -1,   -2,    8,   -5,    9,    0,   -7,
+      12,    8,  -24,   -3,   -2,    3,   -2,   -9,    0,   19,   48,   10,   18,    2,    0,    7,
+       1,    4,    0,    0,    7,   -8,    4,   20,    0,   27,    0,    4,    3,  -10,   -1,    0,
+      -6,   -2,    2,    0,    0,   31,    8,    4,    8,  -14,   20,  -22,    0,    0,    0,   -2,
+      22,    7,    1,   14,    3,    0,    8,  -20,    0,   23,   15,   -8,    2,  -28,  -26,  -17,
+       4,   -5,    1,   14,  -16,    4,   28,    3,    0,    1,   18,  -11,   16,   11,    4,   10,
+      -1,    0,    2,    0,   25,    0,   21,  -24,   23,  -90,    1,   16,    6,    0,   16,    7,
+       1,  -19,   -3,    2,    0,    0,   -2,   11,    8,   14,    9,    5,   22,    2,  -26,   32,
+       9,   -6,  -19,    0,    0,   14,    0,  -15,    0,    3,    1,  -51,    0,    3,   10,    5,
+      -4,   -3,    3,    9,  -10,   -4,  -30,   -1,    2,  -11,    2,   12,    6,   36,    0,  -22,
+      -3,   -7,    4,   -7,   39,    0,    5,   53,  -10,   15,    2,   -1,    0,   -3,    0,    0,
+      -3,    9,   -8,   36,  -11,   -7,   -2,    0,    4,   19,    3,    8,  -28,   -1,    0,   12,
+     -10,    2,    7,    4,   39,    5,    2,    4,    0,    0,    4,   13,   18,    4,   11,    0,
+       7,    2,   -7,  -27,   -1,    0,    7,   11,    3,   -6,   -1,    6,    0,    8,   29,   -5,
+       0,   -1,    7,  -29,   -5,    9,    0,    0,  -14,    0,    7,    8,   -5,    0,    9,   -7,
+       2,   16,   -6,   13,    1,  -11,    6,   41,    0,  -10,    0,  -20,  -17,   11,  -17,  -14,
+       4,    0,   46,    9,    0,   19,   13,  -26,    1,   -4,    0,    4,   -2,   -2,  -36,  -14,
+       1,  -23,    4,    3,   -2,    2,    0,    3,    0,    0,   -3,   -9,    0,    6,  -16,   12,
+     -61,    1,   15,   -4,  -23,  -20,    1,    0,  -16,   12,  -15,    2,   -8,   12,    0,   -1,
+       0,    9,   -3,  -22,  -12,    3,    3,    0,    2,  -25,  -11,   -5,   -9,    7,    6,    0,
+     -11,    1,    0,    0,   -8,   -4,    1,    2,    0,    2,   -7, -122,    0,   35,    3,    0,
+       2,    0,    9,    0,   -1,    0,  -15,   16,   -4,    0,    0,   -6,    4,    0,   -6,  -14,
+      22,  -14,  -24,    0,   13,   -4,   -5,   -4,  -21,  -10,    9,    4,   10,   15,    0,    5,
+       9,    5,   25,   -4,  -10,   -8,    0,    4,   -7,    0,    0,    0,    0,    6,    4,   19,
+       0,    0,   19,   17,    7,  -38,   17,   19,    0,    7,   13,    2,    4,   10, -120,    2,
+      -7,    5,  -27,    6,    0,    0,  -16,    1,    5,    0,    0,    2,    0,  -14,    2,    2,
+      -9,    0,    0,    0,    5,   -3,   -4,   11,   37,    7,   20,   -7,   13,    0,    0,    0,
+     -20,    0,   11,    6,    0,    7,    5,   -4,   -6,   11,    4,   -4,    0,    1,    0,    0,
+       3,   21,    0,    6,    0,    7,    0,    1,    2,  -10,   -4,   -7,  -30,   10,   -3,    9,
+       4,    0,   -9,    0,   -5,  -11,    2,    0,    0,  -10,    0,    4,    0,    0,   15,    0,
+      26,   -6,    0,    0,   14,    4,   -2,    4,    2,  -64,  -18,   53,   -1,    5,   14,    1,
+       0,    0,   -3,    0,  -11,  -36,    4,   -2,   -9,    0,  -24,    2,    8,    0,   12,    0,
+       0,  -13,   -4,   -3,   27,    1,    0,   -5,   -1,   -1,   39,    3,  -11,   -5,   -1,  -41,
+       0,  -28,    4,   22,    2,  -32,   -4,    0,  -15,    0,    6,   -2,    9,   14,   50,   -4,
+      14,    0,    6,   -6,    1,    4,    7,   -1,    0,  -13,    0,   10,   -6,    0,    0,   24,
+      -7,    0,    4,   -1,    0,    1,    0,  -26,   15,   10,    0,    0,    0,    7,   -3,    7,
+      -1,    0,  -29,    0,    1,    0,    0,    0,    2,    4,  -16,   32,   14,   -9,   -3,    2,
+       0,    0,    5,   97,    4,   -1,    3,    2,  -13,    4,   15,  -34,    5,    4,   12,    6,
+     -16,  -14,    2,    0,    0,    2,   -9,  125,   -2,   17,    0,    0,   15,   35,  -13,    0,
+      -3,    0,    0,    0,    0,   -3,  -25,    8,    0,    1,    5,    8,    0,   -1,   -4,    4,
+       0,   -2,   -4,    0,  -16,    9,   -7,  -12,   18,    0,  -25,   31,    3,   -4,   -2,  -10,
+      -4,    8,    6,    0,  -42,  -13,    3,   -1,   -3,   -1,   -1,   17,    6,  -30,    6,   -3,
+       0,   17,   20,    0,   -3,   -3,    7,    5,    0,    0,   -6,    0,    5,    0,   -2,  -17,
+       7,    9,    1,   18,    0,   -3,    0,  -20,    0,   21,   -5,    0,    2,   -2,    7,    0,
+    -107,    9,   -7,    0,   -1,  -13,    3,    8,   -5,    0,   29,  -17,    0,    0,  -26,   -2,
+       8,   11,    0,    2,    3,   -2,    0,    1,    1,   -2,   16,    1,    5,    7,    1,    3,
+       0,  -57,    0,    0,   11,   -6,   -4,  -12,    1,    7,    9,    0,    4,    0,   16,   -5,
+       4,    0,    3,    0,   -1, -103,    3,   10,    0,   -8,    9,    4,    0,   15,  -12,    0,
+       1,    1,   -3,    0,    0,    5,    0,   -9,  -28,    0,    0,    5,    7,    0,    0,    0,
+      -1,    0,   17,  -13,    3,    0,    0,    0,    0,   -3,    0,    0,   10,    0,   17,   -5,
+      74,  -56,    5,   -1, -110,   -4,    4,   26,   20,  -13,    0,   -6,    0,    1,    7,  -29,
+       0,   16,   -1,   -4,    0,    0,    7,    0,   -3,    1,   34,   -3,  -14,    0,   -2,   -2,
+       0,    8,   21,   11,  -14,    0,  -24,    5,    0,    0,    3,  -34,    0,   15,   10,   21,
+       6,   -9,  -23,   -7,    5,    0,    6,    8,    0,   -5,    2,  -11,    3,    3,    3,    7,
+      -9,    0,   17,    3,    5,   -9,    0,    0,    7,  -51,  -26,    0,    7,   24,    4,    6,
+       0,    1,    7,    8,    0,    2,   -5,   -2,   18,    3,   -5,   -6,    3,    0,   16,    0,
+       3,   -3,    0,  -17,    0,    5,  -30,   -6,    1,    6,    8,    0,   -6,  -19,    1,   31,
+       0,   -7,    0,    0,  -21,    0,    2,  -13,    0,  -24,    2,    3,   -9,  -53,  -23,    0,
+     -10,    9,    4,    2,    0,   -5,    0,   -1,    0,  -26,  -24,  -12,   -4,    0,   -5,   -1,
+     -12,   -3,    0,   34,    1,   20,    3,    5,    0,  -18,   13,   -2,   -7,    3,    1,   -4,
+     -19,    0,   -4,    0,    0,    3,    0,    1,   -2,   14,  -18,  -10,   -9,    4,   -2,  -36,
+      12,   -4,  -51,   10,    0,    8,    0,   -5,    0,  -14,    0,    0,    0,  -15,    8,   16,
+      20,   -1,    0,   18,    0,  -17,   25,   17,    0,    2,    2,    0,    6,    7,    0,   30,
+     -62,    2,  -30,    1,   -7,  -47,    8,    2,  -18,    8,  -18,    2,    0,   27,   -7,    3,
+      -4,    0,    6,    2,    0,    0,   -4,    9,    0,    0,    2,   18,    0,    0,   12,   31,
+     -25,   26,    7,    0,    0,   -7,    8,   15,    0,   -3,   -6,    0,    0,    3,    0,   -7,
+      -4,   29,   12,   13,    9,    0,  -32,    1,   20,   -3,   -4,    0,   -3,    7,    0,  -14,
+     -22,    3,  -20,   -1,  -17,    0,   12,   91,    2,    0,  -11,    0,    5,    0,   -7,   56,
+      28,    1,   -1,   -9,   34,   18,    0,    5,  -12,    0,   -5,  -13,    0,    1,  -10,    0,
+      -2,  -10,  -12,    3,    9,    1,   18,    5,   14,  109,    0,   -7,    0,    4,   30,   -6,
+      -3,    2,   -1,  -31,    0,   10,    3,   -7,   13,    6,   10,   -1,    0,   -6,    0,    5,
+       0,   -3,   -1,    0,  -24,    0,   46,   11,    6,    3,   33,   -2,    6,   -3,    0,    8,
+       0,  -51,   -8,    8,  -11,    0,    2,   22,    9,    0,    0,  -18,   -9,   12,    7,    7,
+      -4,    7,   -9,   -2,    0,   -7,   14,   43,   22,   10,   12,    6,    5,    0,   -9,   15,
+       9,    0,    0,    0,    0,  -40,    4,    0,   12,    4,    5,    0,   -1,   -2,    4,   14,
+      14,    0,    0,   25,    1,   16,    0,  -23,   -3,   20,    2,  -10,   -2,   -3,  -10,   -1,
+     -14,    1,    2,    0,   -1,   19,    2,    5,    2,   -2,    0,    0,  -14,   -1,    8,    0,
+       0,   -5,   11,   -4,    0,    0,   -8,    5,    7,    0,    8,   62,    2,    1,    0,    0,
+      -3,    0,   -3,    0,   -1,    5,  -26,    0,   22,    0,  -11,    0,    0,   -5,   -1,   -8,
+       0,    0,    0,    0,    0,   -1,    0,    0,   -7,    5,    1,    0,    2,  -20,   -6,    0,
+       0,   -2,   -2,    4,   26,    3,   -3,    6,   -9,    0,    0,  -20,    0,   -1,    8,    1,
+      -1,   -1,   -1,    0,    0,    6,   -2,  -33,  -10,    6,   12,   14,   -1,    9,   11,   -1,
+       0,    0,    9,    2,   10,    0,  -17,    4,   30,    0,  -11,    1,    6,  -16,   -1,  -28,
+       8,   10,   -1,   16,    1,  -19,  -18,    3,   -1,   -2,   19,    6,   -5,   -3,    0,  -13,
+       0,   11,  -21,   -9,   -3,    8,   11,   30,    7,   -3,    0,   -3,    8,    8,    6,   -4,
+      -2,    0,   -2,  -15,    0,  -10,   -1,    0,   -6,    0,  -18,  -15,    6,   -6,    0,   -4,
+       4,   20,   -2,    7,   -9,    2,    5,    2,  -10,   59,   64,    8,    0,   -8,    5,    5,
+       2,  -21,    0,    0,    0,    7,    0,    0,   10,   90,   12,   -4,    0,    0,    4,    0,
+       0,    0,   -1,   -6,    0,   -5,   -2,    1,  -14,  -20,    0,    0,    0,   12,    8,    5,
+      16,    0,    1,  -21,  -15,   -7,   -3,  -68,    0,    0,   -8,   -2,  -12,    6,    0,  -27,
+      -5,   16,    0,   -9,    0,    8,   -1,   19,   -2,   -3,   23,    0,    0,  -11,  -38,    0,
+       2,  -20,   10,  -24,    7,   35,    0,   11,    6,    9,    0,   -6,    0,  -22,    0,    2,
+       4,    0,   -1,    0,    0,   12,    0,   -4,   -2,   20,    0,    1,    4,    6,    0,   51,
+      -3,    0,   -9,    2,   -6,    6,  -10,    0,   13,   11,   10,    0,   -6,   36,   -8,    2,
+      -3,    5,    0,    1,   12,   -2,   14,    0,    0,    0,  -17,    0,   16,    5,   -7,    0,
+       3,   -1,    0,    0,   -5,   -8,   49,    0,  -28,    6,    0,   -5,    0,  -11,   -4,   -2,
+       7,  -29,   14,    0,    9,    0,   -3,    0,    0,   -5,    0,  -55,   14,  -14,    4,    0,
+      12,    0,   -5,    0,    4,    0,   -1,   -1,    2,   -3,  -37,    2,    7,    5,    0,    0,
+       0,    6,    0,    1,    0,   -1,    5,   -2,    0,    0,   25,   20,   42,  -36,   16,  -10,
+       9,    1,    0,   31,   -8,    0,   -1,    0,    0,    2,    0,    6,   -9,  -22,   15,   -3,
+       8,    0,   31,    0,   -1,   18,   -5,  -18,   10,    1,    6,  -27,   -2,   -1,    1,    2,
+       0,  -28,  -15,    1,   -3,    0,    0,    2,    0,   11,   10,    4,   -1,  -19,   -6,    2,
+      -7,   11,  -11,   23,    0,  -37,    6,  -14,    9,   11,    1,    0,    0,    0,   -3,   -1,
+     -21,   -7,    0,    6,   -9,   12,    0,   13,    3,  -14,  -10,    0,   -2,    0,    7,    0,
+       0,    2,    0,    1,   -2,  -12,   -9,    2,   10,    0,    4,   17,    0,    7,   38,   -4,
+       0,   -4,  -18,   -4,  -12,  -14,    4,   -5,    0,    4,    0,  -21,    0,  -13,   12,    7,
+      -6,    8,   -2,    0,    3,   -5,    0,   -1,    0,    7,   -1,    2,    7,  -19,   -3,    0,
+       0,    0,  -15,    0,   23,  -24,    0,   -1,   -5,   -7,    0,   12,    0,    7,   -4,    6,
+       0,    0,  -14,    2,  -32,   -9,    2,  -11,   -4,   15,    2,   12,    0,    0,  -22,   22,
+       3,   81,   -4,    0,  -13,    9,  -15,   14,  -26,    2,   -2,    5,   -4,  -17,   -5,   -4,
+       2,    9,    0,    0,    0,    5,   -7,    0,    0,    1,    5,    7,    0,    3,  -20,  -21,
+      -6,    0,    7,  -32,  -14,   -2,    0,    0,    8,    0,   -4,    2,    0,    0,   37,  -21,
+       1,    6,   -1,  -14,    2,   -9,   37,    0,   -4,   -1,    4,    0,  -15,   -1,    5,    4,
+       0,    7,    0,  -12,   -3,    0,   -2,   36,    0,   -8,  -35,    0,    4,    0,   -6,    3,
+       6,   -1,  -22,    6,   -4,   10,    3,  -12,    1,  -23,    9,   -4,    0,    5,    1,    9,
+       0,    0,   17,   -9,   -1,    0,    5,   -5,    0,  -11,   -6,   14,   -2,    0,    9,   12,
+       4,  -20,   -3,   12,   -2,    3,    0,  -46,    1,   10,    0,    0,    2,    0,    1,    5,
+      -1,   21,   -2,  -10,    2,   -3,    0,   32,   -1,   -6,   -3,   13,  -21,    0,   12,    0,
+      -1,    4,    2,   14,   -1,   19,   16,  -10,    2,    1,   -2,    0,   -7,   -4,    0,    0,
+      -5,    0,   24,   -8,   -8,    5,    5,   12,  -35,    4,    0,    0,  -16,   -8,   11,   -9,
+       0,    3,    0,    0,    0,    6,   -1,    0,   13,  -11,    1,    1,   -8,    6,  -16,    0,
+       8,    0,  -34,    1,   21,   -7,    6,    0,   -1,   23,   -8,    5,    0,    0,  -16,   20,
+      -6,    0,    0,   -3,   -2,  -25,  -10,   38,    0,   -3,   11,    0,    2,   14,   29,    9,
+     -10,    2,  -11,    0,   22,   -9,    6,   19,  -10,    2,    6,    7,   -2,  -15,  -13,   11,
+       5,    8,   -2,    4,  -12,    8,    0,    1,    0,    8,   -3,   -3,    0,    8,  -36,    0,
+     -11,    2,    0,    0,    9,    7,    0,   16,   -4,  -10,    0,    0,    0,    9,    0,    0,
+     -16,    0,   -9,    4,  -12,    0,    5,   11,    0,    4,   54,   -5,   -3,   -4,   -1,   -2,
+       9,  -10,   14,  -13,  -27,    0,    8,    0,    0,    3,   64,    1,  -17,    2,   11,    0,
+       2,    0,   -2,   20,    2,    0,   -4,    2,    0,    0,    0,    2,    8,    0,    0,   -9,
+       3,    0,   11,   -7,   -1,   -3,  -13,    0,  -12,   -6,   -4,    7,   15,    0,    0,   -7,
+      -8,    0,    1,  -11,    0,  -10,  -19,    0,    0,   11,    0,  -15,   -2,    0,   11,    4,
+     -16,    3,    1,   -6,   10,    1,   -5,    0,    2,    0,    0,   -8,   20,    6,  -15,  -14,
+      -1,    9,    0,    2,   -1,  -15,    9,    4,    2,   10,    8,   -7,    1,    0,    0,    2,
+       7,    0,   -8,    8,    1,  -16,    0,    7,   -9,    4,    0,    1,    4,    5,    8,    7,
+      -9,   19,    3,  -36,  -45,    2,    1,  -16, -103,  -31,    0,   16,   13,   -2,   17,    8,
+       1,   -7,   -2,    5,    0,   11,    0,   14,    3,   -1,   -2,  -19,   21,  -25,   -5,    0,
+       0,  -14,    0,    0,    3,   22,    4,    0,   19,   -4,    0,  -11,    1,    0,    0,   15,
+     -96,    0,   -4,    5,    0,   -4,  -15,   -2,    6,    5,    8,    0,    0,    0,  -13,    0,
+       2,   30,  -10,    0,  -29,   14,    0,   -1,   11,    0,    4,   -8,    0,    6,    0,    7,
+      -3,    0,    2,    6,   13,    0,    4,  -18,    0,    0,   -4,    3,   -4,    6,    1,    0,
+       6,    0,   -8,    0,    0,    9,    3,    8,   -1,   16,    3,    0,    1,    0,  -20,   -4,
+      -1,    0,    0,   -5,    2,    1,  -11,   -5,    0,    3,    0,   -3,   -1,   59,  -21,   -6,
+       0,  -39,    0,  -18,    9,   -8,    2,    0,    5,   -7,    0,   -7,    0,  -46,    0,  -18,
+      -7,   -2,    0,    2,    5,    0,  -21,    1,   -9,   13,    7,  -17,   -5,   -5,    1,    1,
+     -10,    0,    0,    0,   28,   -7,    1,   -6,    0,    8,   20,   13,    5,   35,  -23,   23,
+      39,  -22,    4,   -2,   -4,    0,    0,   -8,  -17,    0,    0,  -29,    0,    0,    0,   14,
+       9,   30,    0,    3,   12,   -6,    4,    5,    7,   -9,   16,    2,    6,   30,   10,   11,
+      24,   -3,    1,    2,    2,    0,    0,   10,    1,    0,    5,    0,    2,  -17,  127,   -2,
+      95,  -25,    0,   10,   -4,   -3,    5,  -25,   15,    8,    9,    5,    0,    7,    2,    3,
+     -25,    6,    0,    0,   -4,    6,    0,   -2,   -7,   -9,    0,    0,   -6,   -3,    9,   18,
+     -29,   -5,    4,  -13,    1,   22,    2,   -1,   18,   -4,    0,    0,    1,   -5,   -1,    0,
+       0,   15,    2,    8,   10,    8,  -22,    7,  -11,    0,    7,    4,  -26,    1,    0,    0,
+       7,    0,    1,  -19,    4,   -2,    3,    3,  -19,  -63,    2,   -1,    7,    0,   12,   -8,
+      -4,    6,  -21,    0,  -10,    9,    0,    4,   13,    6,    0,    0,    0,    0,    0,    0,
+      -6,  -12,    6,    1,    2,    3,    2,  -14,    6,    9,    4,    0,    0,    7,    0,   -5,
+       0,    1,   11,  -23,   14,    6,  -17,    0,    0,  -21,    0,   12,  -18,    1,    0,   13,
+      11,   -2,    0,    0,  -24,    7,   60,    8,  -53,    2,   11,    4,    8,  -10,   26,   -4,
+       2,   15,    0,  -17,   -5,  -62,  -18,    0,    0,   -2,   14,   -1,   -3,   -5,    0,    0,
+       0,  -14,    0,    0,  -12,   14, -102,   13,   18,  -20,    5,    2,    0,    1,   -2,   14,
+       3,   20,  -32,    0,  -50,    3,    0,    0,    4,   -3,    0,  -15,    6,  -19,   12,  -18,
+      13,   -3,  -32,    1,    0,    0,    7,   -4,  -12,    0,    0,   15,    3,    1,   -1,    0,
+       9,   13,   -1,  -11,    0,   -3,   -8,    4,   -5,    0,    0,   13,   -8,    0,    4,  -19,
+       0,   -8,    0,  -12,   -6,   -4,   -9,    2,    0,   13,    1,   -3,   10,    8,    7,  -13,
+       4,   -1,   14,   19,   90,    2,    3,    7,  -17,    0,   -7,    0,    6,    7,   -7,    1,
+      -3,   62,    0,   23,    6,    7,   11,   17,    6,    0,    0,   -7,  -19,   -1,    0,   39,
+       0,  -34,    6,   23,   -5,    0,   11,   23,    0,    7,   20,   -3,   -4,   -7,  -11,   25,
+       6,    0,  -10,    0,    0,    0,   -1,   -2,    0,   16,   -4,   10,   14,  -10,   -3,    8,
+       0,   -2,   13,   23,   52,   -1,  -22,  -11,    0,    0,    1,   -4,    0,    6,  -11,    0,
+      -5,    7,   -2,    0,   -4,    0,   14,    0,   -3,  -34,  -94,   -8,    0,   11,    2,    5,
+       1,  -14,    1,    2,    2,   -7,    8,    5,    9,    9,   -4,    0,   36,   -4,    3,    0,
+      25,    3,   -2,   -7,    6,   15,   -7,   13,   -1,   -3,    4,   10,    2,   13,   -3,  -14,
+      13,    0,    7,   -2,    3,   -3,    1,    4,    7,   14,    7,    0,   -8,  -14,  -15,  -89,
+      -8,    0,  -28,   -2,   -6,    0,   -1,  -10,    3,   -2,    0,   -5,    0,    3,   -1,  -16,
+       5,   -3,    0,    2,    6,    4,    0,   30,  -31,   35,   15,    5,  -19,   -1,    7,    0,
+       2,    6,  -11,   -4,    0,  -10,    2,    1,   21,    0,  -12,   -5,    7,    1,   -3,   17,
+       2,    7,    1,    9,    1,   13,    0,    0,   28,    0,    1,    2,  -11,   -9,   -1,  -26,
+     -61,  -18,   13,    0,    3,    9,   -9,    5,   13,   -2,    0,    0,    0,   -6,    0,    2,
+      -5,    8,   -2,    3,    0,  -12,    0,   14,   10,  -46,    3,   -1,    1,    7,   -9,    0,
+      14,    0,   17,   -4,    4,    0,  -24,    3,    0,   -5,    9,  -55,   -1,   -2,    0,    0,
+       5,   24,    0,    0,    4,    2,    0,   11,    0,    1,    8,  -68,   13,    2,  -10,   -1,
+       1,   25,    0,    0,    0,   -2,   -3,    2,   -7,    0,    0,   14,    3,  -13,    0,    2,
+      -2,   -1,  -34, -102,    6,   22,   -9,   45,   -2,    0,   21,    0,    0,    0,    3,    3,
+      10,   -2,    4,   -6,   -3,   -7,   -1,  -17,    0,   13,    0,  -18,    9,    0,   -3,   11,
+       1,    0,    0,    4,   -8,    0,    0,  -37,    0,    0,    5,   -2,    5,    4,    5,    3,
+      23,    3,    0,  -11,    1,  -11,    2,    3,   -6,    4,   12,   -7,    0,    4,    0,   -5,
+      -7,    6,    0,    1,    4,    2,    3,  -27,    0,   12,   -3,   13,    0,   12,   -7,    8,
+     -18,   -1,   -1,   13,    0,   -2,   -3,    0,    0,    7,    0,    5,    5,   16,    6,   -2,
+      -4,    0,   -3,    0,    0,    0,   30,    0,    7,   11,    2,   -7,    5,  -13,   -6,  -13,
+       0,    7,   16,    9,   -2,    0,    0,   -1,    0,    3,   -5,    8,    0,    0,    0,    3,
+      13,  -11,    0,   17,  -13,    9,   11,   -2,   50,    0,    7,   -3,    3,    0,    8,    6,
+      -2,   11,   22,   -3,    1,    0,    6,    0,   22,   -2,  -23,   13,    4,    0,    2,   10,
+       5,   -6,   13,    0,    5,    0,   15,   23,  -18,    4,   -2,    5,    0,   -3,    0,   -9,
+      23,  -16,   -3,   -4,    2,   -1,    5,  -10,   16,    0,   -6,    0,    1,   -1,   -3,  -48,
+       0,   -1,    5,   72,   -3,   -7,    9,    2,   -6,   10,   -3,   -4,   -8,    0,  -12,   18,
+      -5,   -1,    6,    0,   25,   16,   51,   -2,   11,    0,    0,   -5,    1,    3,    2,    0,
+       0,   10,    8,   -1,   -1,  -18,    0,    0,   18,   -1,    0,    0,   -6,    0,  -25,    0,
+     -53,  -11,   -3,   12,    0,    1,   -8,   -1,   -3,   -3,  -20,    0,   15,    6,   18,    0,
+};
+
+#endif //MAGNUS_LIBER_DOMAIN_MODEL_HPP
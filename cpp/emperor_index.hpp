@@ -0,0 +1,495 @@
+#ifndef MAGNUS_LIBER_EMPEROR_INDEX_HPP
+#define MAGNUS_LIBER_EMPEROR_INDEX_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// An emperor as described by an answer in the format required by the system message:
+//
+//     <Emperor Name> (<Latin or Greek name>)
+//     Start of reign: <start>
+//     End of reign: <end>
+//     <Salient fact>
+struct EmperorRecord
+{
+    std::string name;
+    std::string latinName;
+    std::string reignStart;
+    std::string reignEnd;
+    std::string fact;
+
+    // Years of the reign, negative before Christ, when they could be read from the text
+    std::optional<int> startYear;
+    std::optional<int> endYear;
+};
+
+constexpr std::string_view REIGN_START_LABEL = "Start of reign:";
+constexpr std::string_view REIGN_END_LABEL = "End of reign:";
+
+// Words that may surround the name of an emperor in a question asking only about that emperor
+constexpr std::string_view LOOKUP_WORDS[] = {
+    "about", "describe", "do", "emperor", "info", "information", "is", "know", "me", "of", "tell", "the",
+    "was", "what", "who", "you",
+};
+
+// Words that may separate the names of a list of emperors, besides commas
+constexpr std::string_view LIST_WORDS[] = { "and", "nor", "or", "versus", "vs" };
+
+inline std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && (std::isspace(static_cast<unsigned char>(text.front())) || text.front() == '*'))
+    {
+        text.remove_prefix(1);
+    }
+
+    while (!text.empty() && (std::isspace(static_cast<unsigned char>(text.back())) || text.back() == '*'))
+    {
+        text.remove_suffix(1);
+    }
+
+    return text;
+}
+
+// Lowercase words of `text` separated by single spaces: the form names are looked up in
+inline std::string normaliseName(std::string_view text)
+{
+    std::string normalised;
+
+    for (auto c : text)
+    {
+        if (std::isalnum(static_cast<unsigned char>(c)))
+        {
+            normalised += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        else if (!normalised.empty() && normalised.back() != ' ')
+        {
+            normalised += ' ';
+        }
+    }
+
+    if (!normalised.empty() && normalised.back() == ' ')
+    {
+        normalised.pop_back();
+    }
+
+    return normalised;
+}
+
+// Year of a date such as "16 January 27 BC" or "AD 1453": the last number, negative if followed by BC or BCE
+inline std::optional<int> parseYear(std::string_view date)
+{
+    auto end = date.find_last_of("0123456789");
+
+    if (end == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+
+    auto start = end;
+
+    while (start > 0 && std::isdigit(static_cast<unsigned char>(date[start - 1])))
+    {
+        --start;
+    }
+
+    int year;
+
+    if (std::from_chars(date.data() + start, date.data() + end + 1, year).ec != std::errc())
+    {
+        return std::nullopt;
+    }
+
+    auto era = normaliseName(date.substr(end + 1));
+
+    return era.starts_with("bc") ? -year : year;
+}
+
+// Parse the heading of an answer, "<Name> (<Latin name>)", optionally numbered ("2 - <Name> (<Latin name>)")
+inline bool parseEmperorHeading(std::string_view line, EmperorRecord& record)
+{
+    line = trim(line);
+
+    auto open = line.find(" (");
+    auto close = line.rfind(')');
+
+    if (open == std::string_view::npos || close == std::string_view::npos || close < open)
+    {
+        return false;
+    }
+
+    auto name = line.substr(0, open);
+
+    if (auto dash = name.find(" - "); dash != std::string_view::npos && name.find_first_not_of("0123456789.") == dash)
+    {
+        name.remove_prefix(dash + 3);
+    }
+
+    record.name = trim(name);
+    record.latinName = trim(line.substr(open + 2, close - open - 2));
+
+    return !record.name.empty();
+}
+
+// Extract the emperors described by `answer`. Answers not in the required format give no records.
+inline std::vector<EmperorRecord> parseEmperorAnswer(std::string_view answer)
+{
+    std::vector<EmperorRecord> records;
+    std::vector<std::string_view> lines;
+
+    for (std::size_t start = 0; start < answer.size();)
+    {
+        auto end = answer.find('\n', start);
+        end = end == std::string_view::npos ? answer.size() : end;
+
+        lines.push_back(trim(answer.substr(start, end - start)));
+        start = end + 1;
+    }
+
+    // Each record is a heading followed by the start and end of the reign and the fact
+    for (std::size_t i = 0; i + 3 < lines.size(); ++i)
+    {
+        EmperorRecord record;
+
+        if (!lines[i + 1].starts_with(REIGN_START_LABEL) || !lines[i + 2].starts_with(REIGN_END_LABEL) || !parseEmperorHeading(lines[i], record))
+        {
+            continue;
+        }
+
+        record.reignStart = trim(lines[i + 1].substr(REIGN_START_LABEL.size()));
+        record.reignEnd = trim(lines[i + 2].substr(REIGN_END_LABEL.size()));
+        record.fact = lines[i + 3];
+        record.startYear = parseYear(record.reignStart);
+        record.endYear = parseYear(record.reignEnd);
+
+        if (!record.fact.empty())
+        {
+            records.push_back(std::move(record));
+        }
+
+        i += 3;
+    }
+
+    return records;
+}
+
+// Write `record` back in the format of the answers
+inline std::string formatEmperorRecord(const EmperorRecord& record)
+{
+    return record.name + " (" + record.latinName + ")\n"
+        + std::string(REIGN_START_LABEL) + " " + record.reignStart + "\n"
+        + std::string(REIGN_END_LABEL) + " " + record.reignEnd + "\n"
+        + record.fact;
+}
+
+// Emperors described by previous answers, found by name or Latin name.
+//
+// Names are kept in a trie so the names mentioned in a question are found in a single pass over it.
+// The records are appended to `path` in the format of the answers, so the index is rebuilt by parsing the
+// file again on the next run. A later record of the same emperor replaces the earlier one.
+class EmperorIndex
+{
+public:
+    explicit EmperorIndex(std::filesystem::path path)
+        : path(std::move(path))
+    {
+        nodeRecords.push_back(NO_RECORD);
+
+        std::ifstream file(this->path);
+        std::string text((std::istreambuf_iterator(file)), std::istreambuf_iterator<char>());
+
+        auto savedRecords = parseEmperorAnswer(text);
+
+        for (auto& record : savedRecords)
+        {
+            store(std::move(record));
+        }
+
+        // Drop the records that were replaced by later ones
+        if (savedRecords.size() > records.size())
+        {
+            save();
+        }
+    }
+
+    std::size_t size() const
+    {
+        return records.size();
+    }
+
+    const std::vector<EmperorRecord>& allRecords() const
+    {
+        return records;
+    }
+
+    // Add the emperors described by `answer` and save the new ones
+    void addAnswer(std::string_view answer)
+    {
+        std::ofstream file;
+
+        for (auto& record : parseEmperorAnswer(answer))
+        {
+            auto formatted = formatEmperorRecord(record);
+
+            if (!store(std::move(record)))
+            {
+                continue;
+            }
+
+            if (!file.is_open())
+            {
+                std::error_code error;
+                std::filesystem::create_directories(path.parent_path(), error);
+                file.open(path, std::ios::app);
+
+                if (!file)
+                {
+                    std::cerr << "Warning: Failed to save emperor facts to " << path.string() << "." << std::endl;
+                    return;
+                }
+            }
+
+            file << formatted << "\n\n";
+        }
+    }
+
+    // Return the emperor `question` asks about, if it names a single known emperor and asks nothing else
+    // ("Who was Augustus?", "Tell me about Basil II")
+    const EmperorRecord* findSingle(std::string_view question) const
+    {
+        auto text = normaliseName(question);
+        auto found = NO_RECORD;
+
+        for (std::size_t position = 0; position < text.size();)
+        {
+            auto wordEnd = std::min(text.find(' ', position), text.size());
+            auto [record, nameEnd] = longestName(text, position);
+
+            if (record == AMBIGUOUS)
+            {
+                return nullptr;
+            }
+
+            if (record != NO_RECORD)
+            {
+                if (found != NO_RECORD && found != record)
+                {
+                    return nullptr;
+                }
+
+                found = record;
+                wordEnd = nameEnd;
+            }
+            else if (std::find(std::begin(LOOKUP_WORDS), std::end(LOOKUP_WORDS), text.substr(position, wordEnd - position)) == std::end(LOOKUP_WORDS))
+            {
+                return nullptr;
+            }
+
+            position = wordEnd + 1;
+        }
+
+        return found == NO_RECORD ? nullptr : &records[found];
+    }
+
+    // Return the known emperors named by `question`, in the order they are first named
+    // ("Compare Augustus, Trajan and Hadrian")
+    std::vector<const EmperorRecord*> findAll(std::string_view question) const
+    {
+        auto text = normaliseName(question);
+        std::vector<const EmperorRecord*> found;
+
+        for (std::size_t position = 0; position < text.size();)
+        {
+            auto wordEnd = std::min(text.find(' ', position), text.size());
+            auto [record, nameEnd] = longestName(text, position);
+
+            if (record == AMBIGUOUS)
+            {
+                wordEnd = nameEnd;
+            }
+            else if (record != NO_RECORD)
+            {
+                if (std::find(found.begin(), found.end(), &records[record]) == found.end())
+                {
+                    found.push_back(&records[record]);
+                }
+
+                wordEnd = nameEnd;
+            }
+
+            position = wordEnd + 1;
+        }
+
+        return found;
+    }
+
+    // True if `question` names several emperors as a list, separated only by commas and conjunctions
+    // ("Augustus, Trajan and Hadrian", but not "Titus the son of Vespasian")
+    bool listsNames(std::string_view question) const
+    {
+        auto text = normaliseName(question);
+        std::size_t nameCount = 0;
+        auto separated = true;
+
+        for (std::size_t position = 0; position < text.size();)
+        {
+            auto wordEnd = std::min(text.find(' ', position), text.size());
+            auto [record, nameEnd] = longestName(text, position);
+
+            if (record != NO_RECORD)
+            {
+                if (nameCount > 0 && !separated)
+                {
+                    return false;
+                }
+
+                ++nameCount;
+                separated = true;
+                wordEnd = nameEnd;
+            }
+            else if (std::find(std::begin(LIST_WORDS), std::end(LIST_WORDS), text.substr(position, wordEnd - position)) == std::end(LIST_WORDS))
+            {
+                separated = false;
+            }
+
+            position = wordEnd + 1;
+        }
+
+        return nameCount > 1;
+    }
+
+private:
+    static constexpr std::uint32_t NO_RECORD = UINT32_MAX;
+
+    // A name shared by several emperors ("Titus Flavius Vespasianus"), which finds none of them
+    static constexpr std::uint32_t AMBIGUOUS = UINT32_MAX - 1;
+
+    // Rewrite the file with the current records
+    void save() const
+    {
+        auto temporaryPath = path;
+        temporaryPath += ".tmp";
+
+        {
+            std::ofstream file(temporaryPath, std::ios::trunc);
+
+            for (const auto& record : records)
+            {
+                file << formatEmperorRecord(record) << "\n\n";
+            }
+
+            if (!file)
+            {
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+
+    // Add or replace a record. Returns false if the same record was already known.
+    bool store(EmperorRecord record)
+    {
+        auto key = normaliseName(record.name);
+        auto [existing, added] = recordsByName.try_emplace(key, static_cast<std::uint32_t>(records.size()));
+
+        if (added)
+        {
+            records.push_back(std::move(record));
+        }
+        else if (formatEmperorRecord(records[existing->second]) == formatEmperorRecord(record))
+        {
+            return false;
+        }
+        else
+        {
+            records[existing->second] = std::move(record);
+        }
+
+        const auto& stored = records[existing->second];
+        addName(key, existing->second);
+        addName(normaliseName(stored.latinName), existing->second);
+
+        return true;
+    }
+
+    void addName(const std::string& name, std::uint32_t record)
+    {
+        if (name.empty())
+        {
+            return;
+        }
+
+        std::uint32_t node = 0;
+
+        for (auto c : name)
+        {
+            auto [edge, added] = edges.try_emplace(edgeKey(node, c), static_cast<std::uint32_t>(nodeRecords.size()));
+
+            if (added)
+            {
+                nodeRecords.push_back(NO_RECORD);
+            }
+
+            node = edge->second;
+        }
+
+        auto& named = nodeRecords[node];
+        named = named == NO_RECORD || named == record ? record : AMBIGUOUS;
+    }
+
+    // Longest name starting at `position` of `text` and ending at the end of a word, and where it ends.
+    // The record is AMBIGUOUS if that name belongs to several emperors.
+    std::pair<std::uint32_t, std::size_t> longestName(const std::string& text, std::size_t position) const
+    {
+        std::pair<std::uint32_t, std::size_t> longest { NO_RECORD, position };
+        std::uint32_t node = 0;
+
+        for (auto i = position; i < text.size(); ++i)
+        {
+            auto edge = edges.find(edgeKey(node, text[i]));
+
+            if (edge == edges.end())
+            {
+                break;
+            }
+
+            node = edge->second;
+
+            if (nodeRecords[node] != NO_RECORD && (i + 1 == text.size() || text[i + 1] == ' '))
+            {
+                longest = { nodeRecords[node], i + 1 };
+            }
+        }
+
+        return longest;
+    }
+
+    static std::uint64_t edgeKey(std::uint32_t node, char c)
+    {
+        return static_cast<std::uint64_t>(node) << 8 | static_cast<unsigned char>(c);
+    }
+
+    std::filesystem::path path;
+
+    std::vector<EmperorRecord> records;
+    std::unordered_map<std::string, std::uint32_t> recordsByName;
+
+    // Trie of the normalised names and Latin names: its edges by parent node and character, and the record
+    // whose name ends at each node
+    std::unordered_map<std::uint64_t, std::uint32_t> edges;
+    std::vector<std::uint32_t> nodeRecords;
+};
+
+#endif //MAGNUS_LIBER_EMPEROR_INDEX_HPP
@@ -0,0 +1,140 @@
+#ifndef MAGNUS_LIBER_ENTITY_FAN_OUT_HPP
+#define MAGNUS_LIBER_ENTITY_FAN_OUT_HPP
+
+#include "emperor_index.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A question naming more emperors than this is sent as it is
+constexpr std::size_t MAX_FAN_OUT = 8;
+
+// Words asking the same thing about each of several emperors ("Compare Augustus with Trajan")
+constexpr std::string_view EACH_WORDS[] = { "compare", "comparison", "each" };
+
+// Words asking how emperors relate to one another, which no question about a single one can answer
+constexpr std::string_view RELATION_WORDS[] = { "another", "between", "other" };
+
+// True if `question` asks the same thing about each emperor it names, so it can be split into a question about
+// each: a comparison or a list of names. "Was Titus the son of Vespasian?" is asked as it is.
+inline bool asksAboutEach(std::string_view question, const EmperorIndex& emperorIndex)
+{
+    auto text = normaliseName(question);
+    auto compares = false;
+
+    for (std::size_t start = 0; start < text.size();)
+    {
+        auto end = std::min(text.find(' ', start), text.size());
+        auto word = std::string_view(text).substr(start, end - start);
+        start = end + 1;
+
+        if (std::find(std::begin(RELATION_WORDS), std::end(RELATION_WORDS), word) != std::end(RELATION_WORDS))
+        {
+            return false;
+        }
+
+        compares = compares || std::find(std::begin(EACH_WORDS), std::end(EACH_WORDS), word) != std::end(EACH_WORDS);
+    }
+
+    return compares || emperorIndex.listsNames(question);
+}
+
+// The part of `question` about one of the emperors it names
+inline std::string entityQuestion(std::string_view question, const EmperorRecord& record)
+{
+    std::string text(question);
+
+    text += "\n\nAnswer only about ";
+    text += record.name;
+    text += " (";
+    text += record.latinName;
+    text += ").";
+
+    return text;
+}
+
+// Merge the answers about each emperor into the numbered form of the system message
+inline std::string mergeEntityAnswers(std::span<const std::string> answers)
+{
+    std::string merged;
+
+    for (std::size_t i = 0; i < answers.size(); ++i)
+    {
+        auto answer = trim(answers[i]);
+
+        // An answer about a single emperor may already be numbered "1 - "
+        auto digits = answer.find_first_not_of("0123456789");
+
+        if (digits != 0 && digits != std::string_view::npos && answer.substr(digits).starts_with(" - "))
+        {
+            answer.remove_prefix(digits + 3);
+        }
+
+        if (!merged.empty())
+        {
+            merged += "\n\n";
+        }
+
+        merged += std::to_string(i + 1) + " - ";
+        merged += answer;
+    }
+
+    return merged;
+}
+
+// Call `answer` with each index below `count` at the same time, and return the answers in order.
+// The first is answered on the calling thread, the others on threads of their own, so the whole takes as long as
+// the slowest answer rather than the sum of them. The first exception thrown is rethrown once all are done.
+template<typename Answer>
+std::vector<std::string> answerConcurrently(std::size_t count, Answer answer)
+{
+    std::vector<std::future<std::string>> others;
+
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        others.push_back(std::async(std::launch::async, answer, i));
+    }
+
+    std::vector<std::string> answers;
+    std::exception_ptr error;
+
+    auto collect = [&](auto get) {
+        try
+        {
+            answers.push_back(get());
+        }
+        catch (...)
+        {
+            answers.emplace_back();
+
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    if (count > 0)
+    {
+        collect([&]() { return answer(std::size_t(0)); });
+    }
+
+    for (auto& other : others)
+    {
+        collect([&]() { return other.get(); });
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return answers;
+}
+
+#endif //MAGNUS_LIBER_ENTITY_FAN_OUT_HPP
@@ -0,0 +1,117 @@
+#ifndef MAGNUS_LIBER_HISTORY_COMPACTOR_HPP
+#define MAGNUS_LIBER_HISTORY_COMPACTOR_HPP
+
+#include "conversation_tree.hpp"
+#include "openai.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Instructions given to the model when summarising old turns
+constexpr auto SUMMARY_INSTRUCTIONS =
+    "Summarise the following conversation between a user and Magnus Liber Imperatorum in a few sentences. "
+    "Keep every emperor, date and fact that was discussed so the conversation can continue from the summary alone.";
+
+// Prefix of the message that replaces the summarised turns
+constexpr auto SUMMARY_PREFIX = "Summary of the earlier conversation: ";
+
+// Summarises the oldest messages of the chat history on a background thread.
+// The user facing turn never waits for the summary; it is folded into the history once it is ready.
+class HistoryCompactor
+{
+public:
+    // Summarise the oldest `count` messages of `history`.
+    // `complete` receives the summary conversation and returns the assistant message. It runs on a background thread.
+    template<typename Complete>
+    void start(const ConversationTree& history, std::size_t count, Complete complete)
+    {
+        if (pending() || count == 0)
+        {
+            return;
+        }
+
+        std::vector<ChatMessageView> messages;
+        history.appendTo(messages);
+
+        summarisedCount = std::min(count, messages.size());
+        summarisedBranch = history.currentBranch();
+
+        // Copy the transcript now: the history keeps changing while the summary is in flight
+        std::string transcript;
+
+        for (std::size_t i = 0; i < summarisedCount; ++i)
+        {
+            auto [role, content] = messages[i];
+
+            transcript += roleName(role);
+            transcript += ": ";
+            transcript += content;
+            transcript += "\n";
+        }
+
+        summary = std::async(std::launch::async, [transcript = std::move(transcript), complete]() {
+            std::vector<ChatMessageView> conversation = {
+                { Role::System, SUMMARY_INSTRUCTIONS },
+                { Role::User, transcript },
+            };
+
+            return complete(std::span<const ChatMessageView>(conversation));
+        });
+    }
+
+    // True while a summary is being generated
+    bool pending() const
+    {
+        return summary.valid();
+    }
+
+    // Replace the summarised messages with the summary if it is ready.
+    // If the summary request failed, the summarised messages are dropped like a regular trim.
+    // A summary is discarded if the user switched to another branch in the meantime.
+    void apply(ConversationTree& history)
+    {
+        if (!pending() || summary.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return;
+        }
+
+        std::string summaryText;
+
+        try
+        {
+            summaryText = summary.get();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Warning: Failed to summarise the chat history: " << e.what() << std::endl;
+        }
+
+        if (history.currentBranch() != summarisedBranch)
+        {
+            // The summarised messages are not the oldest of the current branch
+        }
+        else if (summaryText.empty())
+        {
+            history.eraseFront(summarisedCount);
+        }
+        else
+        {
+            history.replaceFront(summarisedCount, Role::System, SUMMARY_PREFIX + summaryText);
+        }
+
+        summarisedCount = 0;
+    }
+
+private:
+    std::future<std::string> summary;
+    std::size_t summarisedCount = 0;
+    std::string summarisedBranch;
+};
+
+#endif //MAGNUS_LIBER_HISTORY_COMPACTOR_HPP
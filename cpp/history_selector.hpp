@@ -0,0 +1,275 @@
+#ifndef MAGNUS_LIBER_HISTORY_SELECTOR_HPP
+#define MAGNUS_LIBER_HISTORY_SELECTOR_HPP
+
+#include "openai.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// How past messages are chosen for each request
+enum class HistorySelection
+{
+    Recent,     // Every message of the chat history
+    Lexical,    // Turns sharing words with the question
+    Hybrid,     // Turns sharing words or character trigrams with the question
+};
+
+// Words too common to say anything about relevance
+constexpr std::string_view RELEVANCE_STOP_WORDS[] = {
+    "about", "and", "are", "can", "did", "does", "for", "from", "had", "has", "have", "him", "his", "how",
+    "her", "its", "me", "reign", "rule", "ruled", "tell", "that", "the", "their", "them", "then", "there",
+    "they", "this", "was", "were", "what", "when", "where", "which", "who", "whom", "why", "with", "you",
+};
+
+// Rough number of tokens taken by a message: about four characters per token, plus the message overhead
+inline std::size_t estimateTokens(std::string_view text)
+{
+    return (text.size() + 3) / 4 + 4;
+}
+
+// Lowercase words of `text` that carry meaning
+inline std::unordered_set<std::string> relevanceTerms(std::string_view text)
+{
+    std::unordered_set<std::string> terms;
+    std::string word;
+
+    auto addWord = [&]() {
+        if (word.size() >= 3 && std::find(std::begin(RELEVANCE_STOP_WORDS), std::end(RELEVANCE_STOP_WORDS), word) == std::end(RELEVANCE_STOP_WORDS))
+        {
+            terms.insert(word);
+        }
+
+        word.clear();
+    };
+
+    for (auto c : text)
+    {
+        if (std::isalnum(static_cast<unsigned char>(c)))
+        {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        else
+        {
+            addWord();
+        }
+    }
+
+    addWord();
+
+    return terms;
+}
+
+// A small local embedding: counts of hashed character trigrams, normalised to unit length.
+// Catches related spellings ("Constantine" and "Constantinople") that whole words miss.
+using TrigramVector = std::array<float, 256>;
+
+constexpr double MIN_TRIGRAM_SIMILARITY = 0.2;
+
+inline TrigramVector trigramVector(std::string_view text)
+{
+    TrigramVector vector {};
+    std::uint32_t window = 0;
+
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        window = (window << 8 | static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(text[i])))) & 0xffffff;
+
+        if (i >= 2)
+        {
+            vector[(window * 2654435761u) >> 24] += 1.0f;
+        }
+    }
+
+    float norm = 0.0f;
+
+    for (auto value : vector)
+    {
+        norm += value * value;
+    }
+
+    if (norm > 0.0f)
+    {
+        norm = std::sqrt(norm);
+
+        for (auto& value : vector)
+        {
+            value /= norm;
+        }
+    }
+
+    return vector;
+}
+
+// Words of `terms` separated by spaces, so trigrams are computed on meaningful words only
+inline std::string joinTerms(const std::unordered_set<std::string>& terms)
+{
+    std::string text;
+
+    for (const auto& term : terms)
+    {
+        text += ' ';
+        text += term;
+    }
+
+    return text;
+}
+
+// Choose which messages of `history` to send with `question`.
+// Past turns are scored against the question and the best ones are kept until `tokenBudget` is spent.
+// Summaries and the most recent turn are always kept so follow-up questions ("Who followed him?") still work.
+// Returns the indices of the selected messages in chronological order.
+inline std::vector<std::size_t> selectHistory(std::span<const ChatMessageView> history, std::string_view question, std::size_t tokenBudget, HistorySelection selection)
+{
+    std::vector<std::size_t> selected;
+
+    if (selection == HistorySelection::Recent)
+    {
+        for (std::size_t i = 0; i < history.size(); ++i)
+        {
+            selected.push_back(i);
+        }
+
+        return selected;
+    }
+
+    // Group the messages in turns: a user message and the replies to it. Summaries are turns of their own.
+    struct Turn
+    {
+        std::size_t first;
+        std::size_t count;
+        std::size_t tokens;
+        bool pinned;
+        double score;
+        double similarity;
+        std::unordered_set<std::string> terms;
+    };
+
+    std::vector<Turn> turns;
+
+    for (std::size_t i = 0; i < history.size(); ++i)
+    {
+        if (turns.empty() || history[i].role != Role::Assistant)
+        {
+            turns.push_back({ i, 0, 0, history[i].role == Role::System, 0.0, 0.0, {} });
+        }
+
+        turns.back().count++;
+        turns.back().tokens += estimateTokens(history[i].content);
+    }
+
+    if (!turns.empty())
+    {
+        turns.back().pinned = true;
+    }
+
+    // Score every turn on the words it shares with the question, weighted by how rare they are in the history
+    auto questionTerms = relevanceTerms(question);
+    auto questionVector = trigramVector(joinTerms(questionTerms));
+
+    for (auto& turn : turns)
+    {
+        std::string text;
+
+        for (auto i = turn.first; i < turn.first + turn.count; ++i)
+        {
+            text += history[i].content;
+            text += ' ';
+        }
+
+        turn.terms = relevanceTerms(text);
+
+        if (selection == HistorySelection::Hybrid)
+        {
+            auto turnVector = trigramVector(joinTerms(turn.terms));
+
+            for (std::size_t i = 0; i < turnVector.size(); ++i)
+            {
+                turn.similarity += questionVector[i] * turnVector[i];
+            }
+        }
+    }
+
+    double totalWeight = 0.0;
+
+    for (const auto& term : questionTerms)
+    {
+        auto frequency = std::count_if(turns.begin(), turns.end(), [&](const Turn& turn) { return turn.terms.contains(term); });
+        auto weight = std::log(1.0 + static_cast<double>(turns.size()) / (1.0 + static_cast<double>(frequency)));
+
+        totalWeight += weight;
+
+        for (auto& turn : turns)
+        {
+            if (turn.terms.contains(term))
+            {
+                turn.score += weight;
+            }
+        }
+    }
+
+    // Lexical scores are relative to a turn containing every word of the question.
+    // In hybrid selection, they count for half of the score and trigram similarity for the other half.
+    for (auto& turn : turns)
+    {
+        if (totalWeight > 0.0)
+        {
+            turn.score /= totalWeight;
+        }
+
+        if (selection == HistorySelection::Hybrid)
+        {
+            // Below the minimum, trigrams are shared by chance
+            turn.score = 0.5 * turn.score + (turn.similarity >= MIN_TRIGRAM_SIMILARITY ? 0.5 * turn.similarity : 0.0);
+        }
+    }
+
+    // Keep pinned turns, then the best scoring ones, most recent first on ties
+    std::vector<std::size_t> order(turns.size());
+
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = turns.size() - 1 - i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return turns[a].pinned != turns[b].pinned ? turns[a].pinned : turns[a].score > turns[b].score;
+    });
+
+    std::size_t tokens = 0;
+    std::vector<std::size_t> selectedTurns;
+
+    for (auto index : order)
+    {
+        const auto& turn = turns[index];
+
+        if (!turn.pinned && (turn.score <= 0.0 || tokens + turn.tokens > tokenBudget))
+        {
+            continue;
+        }
+
+        tokens += turn.tokens;
+        selectedTurns.push_back(index);
+    }
+
+    std::sort(selectedTurns.begin(), selectedTurns.end());
+
+    for (auto index : selectedTurns)
+    {
+        for (auto i = turns[index].first; i < turns[index].first + turns[index].count; ++i)
+        {
+            selected.push_back(i);
+        }
+    }
+
+    return selected;
+}
+
+#endif //MAGNUS_LIBER_HISTORY_SELECTOR_HPP
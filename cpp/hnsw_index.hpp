@@ -0,0 +1,244 @@
+#ifndef MAGNUS_LIBER_HNSW_INDEX_HPP
+#define MAGNUS_LIBER_HNSW_INDEX_HPP
+
+#include "vector_math.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+// An approximate nearest neighbour index of unit vectors: a Hierarchical Navigable Small World graph.
+//
+// Every vector is a node of the bottom layer of the graph, and a random, exponentially decreasing share of
+// them are also nodes of the layers above. A search walks greedily down the sparse upper layers to get close
+// to the query quickly, then explores the bottom layer around that point.
+//
+// Vectors are compared by dot product, which is their cosine similarity since they have unit length.
+class HnswIndex
+{
+public:
+    // Similarity and identifier of a vector, as returned by `search`
+    using Match = std::pair<float, std::uint32_t>;
+
+    explicit HnswIndex(std::size_t dimensions, std::size_t neighbourCount = 16, std::size_t constructionBreadth = 100)
+        : dimensions(dimensions),
+          neighbourCount(neighbourCount),
+          constructionBreadth(constructionBreadth),
+          levelFactor(1.0 / std::log(static_cast<double>(neighbourCount)))
+    {
+    }
+
+    std::size_t size() const
+    {
+        return levels.size();
+    }
+
+    std::size_t dimensionCount() const
+    {
+        return dimensions;
+    }
+
+    // Add a unit vector to the index and return its identifier. Identifiers are assigned in order from 0.
+    std::uint32_t add(std::span<const float> vector)
+    {
+        auto node = static_cast<std::uint32_t>(levels.size());
+        auto level = static_cast<std::size_t>(-std::log(1.0 - uniform(random)) * levelFactor);
+
+        vectors.insert(vectors.end(), vector.begin(), vector.begin() + dimensions);
+        levels.push_back(level);
+        neighbours.emplace_back(level + 1);
+
+        if (node == 0)
+        {
+            entryPoint = 0;
+            return node;
+        }
+
+        // Walk down the layers above the new node to the closest node
+        auto entry = entryPoint;
+
+        for (auto layer = levels[entryPoint]; layer > level; --layer)
+        {
+            entry = searchLayer(vector, entry, 1, layer).front().second;
+        }
+
+        // Connect the node to its closest neighbours on each of its layers
+        for (auto layer = std::min(level, levels[entryPoint]) + 1; layer-- > 0;)
+        {
+            auto candidates = searchLayer(vector, entry, constructionBreadth, layer);
+            auto maximum = maximumNeighbours(layer);
+
+            for (std::size_t i = 0; i < candidates.size() && i < neighbourCount; ++i)
+            {
+                auto neighbour = candidates[i].second;
+
+                neighbours[node][layer].push_back(neighbour);
+                neighbours[neighbour][layer].push_back(node);
+
+                if (neighbours[neighbour][layer].size() > maximum)
+                {
+                    prune(neighbour, layer, maximum);
+                }
+            }
+
+            entry = candidates.front().second;
+        }
+
+        if (level > levels[entryPoint])
+        {
+            entryPoint = node;
+        }
+
+        return node;
+    }
+
+    // Return up to `count` vectors most similar to `query`, most similar first.
+    // `breadth` is how many candidates are explored: larger is slower but finds the true neighbours more often.
+    std::vector<Match> search(std::span<const float> query, std::size_t count, std::size_t breadth = 64) const
+    {
+        if (levels.empty())
+        {
+            return {};
+        }
+
+        auto entry = entryPoint;
+
+        for (auto layer = levels[entryPoint]; layer > 0; --layer)
+        {
+            entry = searchLayer(query, entry, 1, layer).front().second;
+        }
+
+        auto matches = searchLayer(query, entry, std::max(breadth, count), 0);
+        matches.resize(std::min(matches.size(), count));
+
+        return matches;
+    }
+
+    std::span<const float> vector(std::uint32_t node) const
+    {
+        return std::span<const float>(vectors).subspan(node * dimensions, dimensions);
+    }
+
+private:
+    std::size_t maximumNeighbours(std::size_t layer) const
+    {
+        // The bottom layer holds every node and gets twice as many links
+        return layer == 0 ? 2 * neighbourCount : neighbourCount;
+    }
+
+    float similarity(std::span<const float> query, std::uint32_t node) const
+    {
+        return dotProduct(query.data(), vectors.data() + node * dimensions, dimensions);
+    }
+
+    // Keep the `maximum` closest neighbours of `node` on `layer`
+    void prune(std::uint32_t node, std::size_t layer, std::size_t maximum)
+    {
+        auto& links = neighbours[node][layer];
+        auto nodeVector = vector(node);
+
+        std::vector<Match> ranked;
+        ranked.reserve(links.size());
+
+        for (auto link : links)
+        {
+            ranked.emplace_back(similarity(nodeVector, link), link);
+        }
+
+        std::partial_sort(ranked.begin(), ranked.begin() + maximum, ranked.end(), std::greater<>());
+        links.clear();
+
+        for (std::size_t i = 0; i < maximum; ++i)
+        {
+            links.push_back(ranked[i].second);
+        }
+    }
+
+    // Best-first search of one layer from `entry`, returning the `breadth` most similar nodes found, most similar first
+    std::vector<Match> searchLayer(std::span<const float> query, std::uint32_t entry, std::size_t breadth, std::size_t layer) const
+    {
+        std::vector<bool> visited(levels.size());
+
+        // Nodes still to explore, most similar on top, and best nodes found so far, least similar on top
+        std::priority_queue<Match> candidates;
+        std::priority_queue<Match, std::vector<Match>, std::greater<>> found;
+
+        auto entrySimilarity = similarity(query, entry);
+        candidates.emplace(entrySimilarity, entry);
+        found.emplace(entrySimilarity, entry);
+        visited[entry] = true;
+
+        while (!candidates.empty())
+        {
+            auto [candidateSimilarity, candidate] = candidates.top();
+
+            // Every remaining candidate is further than the worst of the results
+            if (candidateSimilarity < found.top().first && found.size() >= breadth)
+            {
+                break;
+            }
+
+            candidates.pop();
+
+            for (auto neighbour : neighbours[candidate][layer])
+            {
+                if (visited[neighbour])
+                {
+                    continue;
+                }
+
+                visited[neighbour] = true;
+
+                auto neighbourSimilarity = similarity(query, neighbour);
+
+                if (found.size() < breadth || neighbourSimilarity > found.top().first)
+                {
+                    candidates.emplace(neighbourSimilarity, neighbour);
+                    found.emplace(neighbourSimilarity, neighbour);
+
+                    if (found.size() > breadth)
+                    {
+                        found.pop();
+                    }
+                }
+            }
+        }
+
+        std::vector<Match> matches;
+        matches.reserve(found.size());
+
+        while (!found.empty())
+        {
+            matches.push_back(found.top());
+            found.pop();
+        }
+
+        std::reverse(matches.begin(), matches.end());
+
+        return matches;
+    }
+
+    std::size_t dimensions;
+    std::size_t neighbourCount;
+    std::size_t constructionBreadth;
+    double levelFactor;
+
+    // Vectors of every node, one after the other
+    std::vector<float> vectors;
+
+    // Highest layer of each node, and its neighbours on each layer
+    std::vector<std::size_t> levels;
+    std::vector<std::vector<std::vector<std::uint32_t>>> neighbours;
+    std::uint32_t entryPoint = 0;
+
+    std::mt19937 random { 42 };
+    std::uniform_real_distribution<double> uniform { 0.0, 1.0 };
+};
+
+#endif //MAGNUS_LIBER_HNSW_INDEX_HPP
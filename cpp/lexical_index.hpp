@@ -0,0 +1,572 @@
+#ifndef MAGNUS_LIBER_LEXICAL_INDEX_HPP
+#define MAGNUS_LIBER_LEXICAL_INDEX_HPP
+
+#include "history_selector.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// How the passages sent with a question are found
+enum class PassageRetrieval
+{
+    Lexical,    // BM25 over the words of the question: no request, best for names
+    Vector,     // Similarity of embeddings: finds passages phrased differently from the question
+};
+
+// Lexical indexes are inverted indexes of the passages of a corpus, written by `--index-corpus` and
+// memory-mapped at run time:
+//
+//   [header: LexicalIndexHeader]
+//   [terms: termCount * LexicalTerm, sorted by term]
+//   [blocks: LexicalBlock for every block of every term]
+//   [postings: varint-encoded (passage delta, term frequency) pairs, in blocks of LEXICAL_BLOCK_SIZE]
+//   [passages: passageCount * LexicalPassage]
+//   [strings: the terms]
+//   [text of the passages]
+//
+// Each block records its last passage and its best BM25 score, so a block-max WAND search skips the blocks
+// that cannot make it into the top results without decoding them.
+
+constexpr auto CORPUS_POSTINGS_FILE = "corpus.postings";
+constexpr char LEXICAL_INDEX_MAGIC[8] = { 'M', 'L', 'B', 'M', '2', '5', '0', '1' };
+constexpr std::size_t LEXICAL_BLOCK_SIZE = 128;
+
+// BM25 parameters: saturation of term frequency and normalisation by passage length
+constexpr float BM25_K1 = 1.2f;
+constexpr float BM25_B = 0.75f;
+
+// Passages are only sent with a question if they score at least this much, about one rare word in common
+constexpr float MIN_PASSAGE_SCORE = 2.0f;
+
+struct LexicalIndexHeader
+{
+    char magic[8];
+    std::uint32_t passageCount;
+    std::uint32_t termCount;
+    float averageLength;
+    float k1;
+    float b;
+    std::uint32_t reserved;
+    std::uint64_t termsOffset;
+    std::uint64_t blocksOffset;
+    std::uint64_t postingsOffset;
+    std::uint64_t passagesOffset;
+    std::uint64_t stringsOffset;
+    std::uint64_t textOffset;
+};
+
+struct LexicalTerm
+{
+    std::uint64_t stringOffset;
+    std::uint32_t stringLength;
+    std::uint32_t passageCount;
+    std::uint32_t firstBlock;
+    std::uint32_t blockCount;
+    float maxScore;
+    std::uint32_t reserved;
+};
+
+struct LexicalBlock
+{
+    std::uint32_t lastPassage;
+    float maxScore;
+    std::uint64_t postingsOffset;
+};
+
+struct LexicalPassage
+{
+    std::uint64_t textOffset;
+    std::uint32_t textLength;
+    std::uint32_t termCount;
+};
+
+// Words of `text` that are searched: lowercase, two characters or more ("ii" in "Basil II"), not stop words
+inline std::vector<std::string> searchTerms(std::string_view text)
+{
+    std::vector<std::string> terms;
+    std::string word;
+
+    auto addWord = [&]() {
+        if (word.size() >= 2 && std::find(std::begin(RELEVANCE_STOP_WORDS), std::end(RELEVANCE_STOP_WORDS), word) == std::end(RELEVANCE_STOP_WORDS))
+        {
+            terms.push_back(word);
+        }
+
+        word.clear();
+    };
+
+    for (auto c : text)
+    {
+        if (std::isalnum(static_cast<unsigned char>(c)))
+        {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        else
+        {
+            addWord();
+        }
+    }
+
+    addWord();
+
+    return terms;
+}
+
+inline float bm25Idf(std::size_t passageCount, std::size_t termPassageCount)
+{
+    return std::log(1.0f + (static_cast<float>(passageCount) - static_cast<float>(termPassageCount) + 0.5f) / (static_cast<float>(termPassageCount) + 0.5f));
+}
+
+inline float bm25Score(float idf, std::uint32_t frequency, std::uint32_t length, float averageLength)
+{
+    auto tf = static_cast<float>(frequency);
+
+    return idf * tf * (BM25_K1 + 1.0f) / (tf + BM25_K1 * (1.0f - BM25_B + BM25_B * static_cast<float>(length) / averageLength));
+}
+
+inline void appendVarint(std::string& out, std::uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+
+    out += static_cast<char>(value);
+}
+
+inline std::uint32_t readVarint(const unsigned char*& in)
+{
+    std::uint32_t value = 0;
+
+    for (int shift = 0;; shift += 7)
+    {
+        auto byte = *in++;
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+
+        if (byte < 0x80)
+        {
+            return value;
+        }
+    }
+}
+
+// Write the lexical index of `passages`
+inline void writeLexicalIndex(const std::filesystem::path& path, const std::vector<std::string>& passages)
+{
+    // Postings of every term, by passage
+    std::map<std::string, std::vector<std::pair<std::uint32_t, std::uint32_t>>> postings;
+    std::vector<LexicalPassage> passageEntries;
+    std::uint64_t textSize = 0;
+    std::uint64_t totalLength = 0;
+
+    for (std::uint32_t passage = 0; passage < passages.size(); ++passage)
+    {
+        auto terms = searchTerms(passages[passage]);
+        std::sort(terms.begin(), terms.end());
+
+        for (std::size_t i = 0; i < terms.size();)
+        {
+            auto end = std::upper_bound(terms.begin() + i, terms.end(), terms[i]) - terms.begin();
+            postings[terms[i]].emplace_back(passage, static_cast<std::uint32_t>(end - i));
+            i = end;
+        }
+
+        passageEntries.push_back({ textSize, static_cast<std::uint32_t>(passages[passage].size()), static_cast<std::uint32_t>(terms.size()) });
+        textSize += passages[passage].size();
+        totalLength += terms.size();
+    }
+
+    LexicalIndexHeader header {};
+    std::memcpy(header.magic, LEXICAL_INDEX_MAGIC, sizeof(header.magic));
+    header.passageCount = static_cast<std::uint32_t>(passages.size());
+    header.termCount = static_cast<std::uint32_t>(postings.size());
+    header.averageLength = passages.empty() ? 1.0f : std::max(1.0f, static_cast<float>(totalLength) / static_cast<float>(passages.size()));
+    header.k1 = BM25_K1;
+    header.b = BM25_B;
+
+    // Encode the postings in blocks, keeping the best score of each block
+    std::vector<LexicalTerm> terms;
+    std::vector<LexicalBlock> blocks;
+    std::string encodedPostings;
+    std::string strings;
+
+    for (const auto& [term, termPostings] : postings)
+    {
+        auto idf = bm25Idf(passages.size(), termPostings.size());
+        LexicalTerm entry { strings.size(), static_cast<std::uint32_t>(term.size()), static_cast<std::uint32_t>(termPostings.size()), static_cast<std::uint32_t>(blocks.size()), 0, 0.0f, 0 };
+        std::uint32_t previous = 0;
+
+        strings += term;
+
+        for (std::size_t start = 0; start < termPostings.size(); start += LEXICAL_BLOCK_SIZE)
+        {
+            auto end = std::min(start + LEXICAL_BLOCK_SIZE, termPostings.size());
+            LexicalBlock block { termPostings[end - 1].first, 0.0f, encodedPostings.size() };
+
+            for (auto i = start; i < end; ++i)
+            {
+                auto [passage, frequency] = termPostings[i];
+
+                appendVarint(encodedPostings, passage - previous);
+                appendVarint(encodedPostings, frequency);
+                previous = passage;
+
+                block.maxScore = std::max(block.maxScore, bm25Score(idf, frequency, passageEntries[passage].termCount, header.averageLength));
+            }
+
+            entry.maxScore = std::max(entry.maxScore, block.maxScore);
+            ++entry.blockCount;
+            blocks.push_back(block);
+        }
+
+        terms.push_back(entry);
+    }
+
+    header.termsOffset = sizeof(header);
+    header.blocksOffset = header.termsOffset + terms.size() * sizeof(LexicalTerm);
+    header.postingsOffset = header.blocksOffset + blocks.size() * sizeof(LexicalBlock);
+    header.passagesOffset = header.postingsOffset + ((encodedPostings.size() + 7) & ~std::size_t(7));
+    header.stringsOffset = header.passagesOffset + passageEntries.size() * sizeof(LexicalPassage);
+    header.textOffset = header.stringsOffset + strings.size();
+
+    encodedPostings.resize(header.passagesOffset - header.postingsOffset);
+
+    auto temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        auto write = [&](const void* data, std::size_t size) {
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        };
+
+        write(&header, sizeof(header));
+        write(terms.data(), terms.size() * sizeof(LexicalTerm));
+        write(blocks.data(), blocks.size() * sizeof(LexicalBlock));
+        write(encodedPostings.data(), encodedPostings.size());
+        write(passageEntries.data(), passageEntries.size() * sizeof(LexicalPassage));
+        write(strings.data(), strings.size());
+
+        for (const auto& passage : passages)
+        {
+            write(passage.data(), passage.size());
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("Failed to write " + temporaryPath.string());
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path);
+}
+
+// A read-only, memory-mapped lexical index
+class LexicalIndex
+{
+public:
+    // BM25 score and index of a passage
+    using Match = std::pair<float, std::uint32_t>;
+
+    explicit LexicalIndex(const std::string& path)
+        : mapping(path)
+    {
+        if (mapping.size() < sizeof(LexicalIndexHeader))
+        {
+            throw std::runtime_error(path + " is not a lexical index");
+        }
+
+        std::memcpy(&header, mapping.data(), sizeof(header));
+
+        if (std::memcmp(header.magic, LEXICAL_INDEX_MAGIC, sizeof(header.magic)) != 0 || header.textOffset > mapping.size())
+        {
+            throw std::runtime_error(path + " is not a valid lexical index");
+        }
+
+        terms = reinterpret_cast<const LexicalTerm*>(mapping.data() + header.termsOffset);
+        blocks = reinterpret_cast<const LexicalBlock*>(mapping.data() + header.blocksOffset);
+        passages = reinterpret_cast<const LexicalPassage*>(mapping.data() + header.passagesOffset);
+    }
+
+    std::size_t size() const
+    {
+        return header.passageCount;
+    }
+
+    std::string_view passage(std::uint32_t index) const
+    {
+        return mapping.view().substr(header.textOffset + passages[index].textOffset, passages[index].textLength);
+    }
+
+    // Return the `count` passages with the best BM25 score for the words of `query`, best first
+    std::vector<Match> search(std::string_view query, std::size_t count) const
+    {
+        auto queryTerms = searchTerms(query);
+        std::sort(queryTerms.begin(), queryTerms.end());
+        queryTerms.erase(std::unique(queryTerms.begin(), queryTerms.end()), queryTerms.end());
+
+        std::vector<Cursor> cursors;
+
+        for (const auto& term : queryTerms)
+        {
+            if (auto entry = findTerm(term))
+            {
+                cursors.emplace_back(*this, *entry);
+            }
+        }
+
+        return blockMaxWand(cursors, count);
+    }
+
+private:
+    static constexpr auto END = UINT32_MAX;
+
+    // Iterates over the postings of a term, decoding one block at a time
+    struct Cursor
+    {
+        Cursor(const LexicalIndex& index, const LexicalTerm& term)
+            : index(&index), term(&term), idf(bm25Idf(index.size(), term.passageCount))
+        {
+            load(0);
+        }
+
+        std::uint32_t passage() const
+        {
+            return block < term->blockCount ? passages[position] : END;
+        }
+
+        float score() const
+        {
+            return bm25Score(idf, frequencies[position], index->passages[passages[position]].termCount, index->header.averageLength);
+        }
+
+        void next()
+        {
+            if (++position == count)
+            {
+                load(block + 1);
+            }
+        }
+
+        // Move to the first passage at or after `target`
+        void advance(std::uint32_t target)
+        {
+            auto targetBlock = shallowAdvance(target);
+
+            if (targetBlock != block)
+            {
+                load(targetBlock);
+            }
+
+            while (passage() < target)
+            {
+                next();
+            }
+        }
+
+        // Block that would hold `target`, without decoding it
+        std::uint32_t shallowAdvance(std::uint32_t target) const
+        {
+            auto candidate = block;
+
+            while (candidate < term->blockCount && blockEntry(candidate).lastPassage < target)
+            {
+                ++candidate;
+            }
+
+            return candidate;
+        }
+
+        const LexicalBlock& blockEntry(std::uint32_t i) const
+        {
+            return index->blocks[term->firstBlock + i];
+        }
+
+        void load(std::uint32_t i)
+        {
+            block = i;
+            position = 0;
+            count = 0;
+
+            if (block >= term->blockCount)
+            {
+                return;
+            }
+
+            // Passages are stored as deltas from the previous one, across blocks
+            auto previous = block == 0 ? 0 : blockEntry(block - 1).lastPassage;
+            auto in = reinterpret_cast<const unsigned char*>(index->mapping.data() + index->header.postingsOffset + blockEntry(block).postingsOffset);
+            auto remaining = std::min<std::size_t>(LEXICAL_BLOCK_SIZE, term->passageCount - block * LEXICAL_BLOCK_SIZE);
+
+            for (; count < remaining; ++count)
+            {
+                previous += readVarint(in);
+                passages[count] = previous;
+                frequencies[count] = readVarint(in);
+            }
+        }
+
+        const LexicalIndex* index;
+        const LexicalTerm* term;
+        float idf;
+
+        std::uint32_t block = 0;
+        std::uint32_t position = 0;
+        std::uint32_t count = 0;
+        std::array<std::uint32_t, LEXICAL_BLOCK_SIZE> passages;
+        std::array<std::uint32_t, LEXICAL_BLOCK_SIZE> frequencies;
+    };
+
+    const LexicalTerm* findTerm(std::string_view term) const
+    {
+        auto termString = [&](const LexicalTerm& entry) {
+            return mapping.view().substr(header.stringsOffset + entry.stringOffset, entry.stringLength);
+        };
+
+        auto found = std::lower_bound(terms, terms + header.termCount, term, [&](const LexicalTerm& entry, std::string_view value) {
+            return termString(entry) < value;
+        });
+
+        return found != terms + header.termCount && termString(*found) == term ? found : nullptr;
+    }
+
+    // Block-max WAND: only score passages whose terms could beat the current top results, first by the best
+    // score of each term, then by the best score of the blocks the passage is in
+    static std::vector<Match> blockMaxWand(std::vector<Cursor>& cursors, std::size_t count)
+    {
+        std::priority_queue<Match, std::vector<Match>, std::greater<>> best;
+
+        auto threshold = [&]() {
+            return best.size() < count ? 0.0f : best.top().first;
+        };
+
+        std::vector<Cursor*> active;
+
+        for (auto& cursor : cursors)
+        {
+            active.push_back(&cursor);
+        }
+
+        while (count > 0)
+        {
+            std::erase_if(active, [](const Cursor* cursor) { return cursor->passage() == END; });
+            std::sort(active.begin(), active.end(), [](const Cursor* a, const Cursor* b) { return a->passage() < b->passage(); });
+
+            // The pivot is the first passage whose terms could together beat the threshold
+            std::size_t pivot = 0;
+            auto bound = 0.0f;
+
+            for (; pivot < active.size(); ++pivot)
+            {
+                bound += active[pivot]->term->maxScore;
+
+                if (bound > threshold())
+                {
+                    break;
+                }
+            }
+
+            if (pivot == active.size())
+            {
+                break;
+            }
+
+            auto pivotPassage = active[pivot]->passage();
+
+            while (pivot + 1 < active.size() && active[pivot + 1]->passage() == pivotPassage)
+            {
+                ++pivot;
+            }
+
+            // Check the tighter bound of the blocks holding the pivot
+            auto blockBound = 0.0f;
+            auto nextCandidate = pivot + 1 < active.size() ? active[pivot + 1]->passage() : END;
+
+            for (std::size_t i = 0; i <= pivot; ++i)
+            {
+                auto block = active[i]->shallowAdvance(pivotPassage);
+
+                if (block < active[i]->term->blockCount)
+                {
+                    blockBound += active[i]->blockEntry(block).maxScore;
+                    nextCandidate = std::min(nextCandidate, active[i]->blockEntry(block).lastPassage + 1);
+                }
+            }
+
+            if (blockBound <= threshold())
+            {
+                // No passage before the end of these blocks can make it: skip past them
+                auto target = std::max(nextCandidate, pivotPassage + 1);
+
+                for (std::size_t i = 0; i <= pivot; ++i)
+                {
+                    active[i]->advance(target);
+                }
+            }
+            else if (active[0]->passage() == pivotPassage)
+            {
+                auto score = 0.0f;
+
+                for (std::size_t i = 0; i <= pivot; ++i)
+                {
+                    score += active[i]->score();
+                    active[i]->next();
+                }
+
+                if (best.size() < count)
+                {
+                    best.emplace(score, pivotPassage);
+                }
+                else if (score > best.top().first)
+                {
+                    best.pop();
+                    best.emplace(score, pivotPassage);
+                }
+            }
+            else
+            {
+                // Bring the terms before the pivot up to it
+                for (std::size_t i = 0; i < pivot; ++i)
+                {
+                    active[i]->advance(pivotPassage);
+                }
+            }
+        }
+
+        std::vector<Match> matches;
+
+        for (; !best.empty(); best.pop())
+        {
+            matches.push_back(best.top());
+        }
+
+        std::reverse(matches.begin(), matches.end());
+
+        return matches;
+    }
+
+    MappedFile mapping;
+    LexicalIndexHeader header {};
+    const LexicalTerm* terms = nullptr;
+    const LexicalBlock* blocks = nullptr;
+    const LexicalPassage* passages = nullptr;
+};
+
+#endif //MAGNUS_LIBER_LEXICAL_INDEX_HPP
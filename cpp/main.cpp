@@ -1,50 +1,250 @@
-#include "root_certificates.hpp"
+#include "openai.hpp"
+#include "batch_input.hpp"
+#include "batch_journal.hpp"
+#include "batch_runner.hpp"
+#include "conversation_tree.hpp"
+#include "domain_classifier.hpp"
+#include "emperor_index.hpp"
+#include "entity_fan_out.hpp"
+#include "history_compactor.hpp"
+#include "history_selector.hpp"
+#include "lexical_index.hpp"
+#include "map_reduce.hpp"
+#include "persistent_cache.hpp"
+#include "prefetcher.hpp"
+#include "question_packer.hpp"
+#include "reign_timeline.hpp"
+#include "response_cache.hpp"
+#include "semantic_cache.hpp"
+#include "session_log.hpp"
+#include "single_flight.hpp"
+#include "thread_pool.hpp"
+#include "vector_store.hpp"
 
-#include "boost/asio.hpp"
-#include "boost/asio/ssl.hpp"
-#include "boost/beast.hpp"
-#include "boost/beast/ssl.hpp"
-#include <boost/json.hpp>
 #include <boost/url.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
 
-// Since the C++ SDK for OpenAI is not yet available, we will reproduce some basic data structures here.
-
-// The chat message request roles
-constexpr auto ROLE_SYSTEM = "system";
-constexpr auto ROLE_USER = "user";
-constexpr auto ROLE_ASSISTANT = "assistant";
-
-// The following chat roles are not used in the demo but included for completion
-constexpr auto ROLE_TOOL = "tool";
-constexpr auto ROLE_FUNCTION = "function";
-
-// An OpenAI chat message request
-struct ChatMessageRequest
-{
-    std::string role;
-    std::string content;
-};
-
-int main()
+int main(int argc, char* argv[])
 {
     // Setup configuration
     auto openAiUri = std::getenv("OPENAI_URL");
     auto openAiKey = std::getenv("OPENAI_KEY");
     auto deployment = std::getenv("OPENAI_DEPLOYMENT");
+    auto embeddingDeployment = std::getenv("OPENAI_EMBEDDING_DEPLOYMENT");
     auto historyLength = 10;
     auto maxTokens = 1500;
+    auto summaryMaxTokens = 300;
+    auto historyTokenBudget = 1000;
+    auto responseCacheSize = 16 * 1024 * 1024;
+    auto persistentCacheSize = 256 * 1024 * 1024;
+    auto semanticCacheSize = 10000;
+    auto prefetchBudget = 0;
+    auto passageCount = 3;
+    auto batchConcurrency = 8;
+    auto packSize = 1;
+    auto threadCount = static_cast<int>(std::thread::hardware_concurrency());
+
+    // Name of the session log. Defaults to the time the session started.
+    auto startTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::ostringstream sessionName;
+    sessionName << "session-" << std::put_time(std::localtime(&startTime), "%Y%m%d-%H%M%S");
+
+    auto resumeSession = false;
+    auto sessionNamed = false;
+    auto fsyncPolicy = FsyncPolicy::Periodic;
+    auto historySelection = HistorySelection::Lexical;
+    auto passageRetrieval = PassageRetrieval::Lexical;
+    auto temperature = 1.0;
+    auto cacheSampledAnswers = false;
+    std::string cacheDirectory = "MagnusLiber.cache";
+    auto useSemanticCache = false;
+    auto useFactIndex = true;
+    auto useDomainFilter = true;
+    auto useFanOut = true;
+    auto semanticThreshold = DEFAULT_SEMANTIC_THRESHOLD;
+    std::string corpusDirectory;
+    std::string batchPath;
+    std::string batchOutputPath;
+    auto batchFormat = BatchFormat::Text;
+
+    // Parse command line options
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "--resume")
+        {
+            // A batch is resumed from the journal of its output, so it needs no session name
+            if (i + 1 < argc && !std::string_view(argv[i + 1]).starts_with("--"))
+            {
+                sessionName.str(argv[++i]);
+                sessionNamed = true;
+            }
+
+            resumeSession = true;
+        }
+        else if (argument == "--fsync" && i + 1 < argc)
+        {
+            std::string policy = argv[++i];
+
+            fsyncPolicy = policy == "always" ? FsyncPolicy::Always : policy == "never" ? FsyncPolicy::Never : FsyncPolicy::Periodic;
+        }
+        else if (argument == "--history" && i + 1 < argc)
+        {
+            std::string selection = argv[++i];
+
+            historySelection = selection == "recent" ? HistorySelection::Recent : selection == "hybrid" ? HistorySelection::Hybrid : HistorySelection::Lexical;
+        }
+        else if (argument == "--temperature" && i + 1 < argc)
+        {
+            temperature = std::stod(argv[++i]);
+        }
+        else if (argument == "--cache-sampled")
+        {
+            cacheSampledAnswers = true;
+        }
+        else if (argument == "--cache-dir" && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+        }
+        else if (argument == "--no-fact-index")
+        {
+            useFactIndex = false;
+        }
+        else if (argument == "--no-domain-filter")
+        {
+            useDomainFilter = false;
+        }
+        else if (argument == "--no-fan-out")
+        {
+            useFanOut = false;
+        }
+        else if (argument == "--prefetch" && i + 1 < argc)
+        {
+            prefetchBudget = std::stoi(argv[++i]);
+        }
+        else if (argument == "--index-corpus" && i + 1 < argc)
+        {
+            corpusDirectory = argv[++i];
+        }
+        else if (argument == "--passages" && i + 1 < argc)
+        {
+            passageCount = std::stoi(argv[++i]);
+        }
+        else if (argument == "--batch" && i + 1 < argc)
+        {
+            batchPath = argv[++i];
+        }
+        else if (argument == "--batch-output" && i + 1 < argc)
+        {
+            batchOutputPath = argv[++i];
+        }
+        else if (argument == "--output" && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+
+            batchFormat = format == "jsonl" ? BatchFormat::JsonLines : BatchFormat::Text;
+        }
+        else if (argument == "--concurrency" && i + 1 < argc)
+        {
+            batchConcurrency = std::stoi(argv[++i]);
+        }
+        else if (argument == "--pack" && i + 1 < argc)
+        {
+            packSize = std::stoi(argv[++i]);
+        }
+        else if (argument == "--threads" && i + 1 < argc)
+        {
+            threadCount = std::stoi(argv[++i]);
+        }
+        else if (argument == "--retrieval" && i + 1 < argc)
+        {
+            std::string retrieval = argv[++i];
+
+            passageRetrieval = retrieval == "vector" ? PassageRetrieval::Vector : PassageRetrieval::Lexical;
+        }
+        else if (argument == "--semantic-cache" && i + 1 < argc)
+        {
+            useSemanticCache = true;
+            semanticThreshold = std::stod(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "Usage: MagnusLiber [--resume [<session>]] [--fsync always|periodic|never] [--history recent|lexical|hybrid] [--temperature <t>] [--cache-sampled] [--cache-dir <directory>] [--semantic-cache <threshold>] [--no-fact-index] [--no-domain-filter] [--no-fan-out] [--prefetch <tokens>] [--index-corpus <directory>] [--passages <count>] [--retrieval lexical|vector] [--batch <file>] [--batch-output <file>] [--output text|jsonl] [--concurrency <n>] [--pack <k>] [--threads <n>]" << std::endl;
+            return 1;
+        }
+    }
 
     // Validate configuration
+    if (resumeSession && (batchPath.empty() ? !sessionNamed : batchOutputPath.empty()))
+    {
+        std::cerr << "Error: --resume needs the name of a session, or --batch-output to resume a batch." << std::endl;
+        return 1;
+    }
+
     if (openAiUri == nullptr || openAiKey == nullptr || deployment == nullptr) {
         std::cerr << "Error: Environment variables OPENAPI_URL, OPENAPI_KEY, and OPENAPI_DEPLOYMENT must be set." << std::endl;
         return 1;
     }
 
+    ChatCompletionOptions completionOptions;
+    completionOptions.maxTokens = maxTokens;
+    completionOptions.temperature = temperature;
+
+    ChatCompletionOptions summaryOptions;
+    summaryOptions.maxTokens = summaryMaxTokens;
+
+    // Answers to previous questions.
+    // With a temperature above 0, the same question is expected to get different answers, so answers are only
+    // reused if `--cache-sampled` is given.
+    // Answers are also kept on disk and shared by every run, unless the cache directory cannot be opened
+    ResponseCache responseCache(responseCacheSize);
+    std::optional<PersistentResponseCache> persistentCache;
+    auto useResponseCache = temperature == 0.0 || cacheSampledAnswers;
+
+    if (useResponseCache)
+    {
+        try
+        {
+            persistentCache.emplace(cacheDirectory, persistentCacheSize);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Warning: Answers are not kept between runs: " << e.what() << std::endl;
+        }
+    }
+
+    // Answers to questions that mean the same as a previous one, if `--semantic-cache` is given
+    SemanticCache semanticCache(semanticThreshold, semanticCacheSize);
+    useSemanticCache = useSemanticCache && useResponseCache;
+    SingleFlight singleFlight;
+
+    // Emperors described by previous answers, so questions about a single one are answered locally
+    EmperorIndex emperorIndex(std::filesystem::path(cacheDirectory) / "emperors.txt");
+    ReignTimeline reignTimeline(emperorIndex);
+    std::size_t factAnswers = 0;
+    std::size_t refusedQuestions = 0;
+    std::size_t fanOutQuestions = 0;
+    std::size_t fanOutRequests = 0;
+    std::size_t mapReduceQuestions = 0;
+    std::size_t mapRequests = 0;
+
+    // Prefetched answers are remembered until a question uses them, to measure the hit rate
+    std::unordered_set<std::string> speculativeAnswers;
+    std::size_t speculativeHits = 0;
+
     // Load system message
     auto systemMessageFile = std::ifstream("../SystemMessage.txt");
     std::string systemMessageText(
@@ -52,23 +252,35 @@ int main()
         (std::istreambuf_iterator<char>())
     );
 
-    ChatMessageRequest systemMessage = {
-        ROLE_SYSTEM,
+    ChatMessageView systemMessage = {
+        Role::System,
         systemMessageText
     };
 
-    // Create empty chat history
-    std::vector<ChatMessageRequest> chatHistory;
+    // Load the refusal given to questions about other subjects
+    auto messagesFile = std::ifstream("../Messages.json");
+    std::string messagesText(
+        (std::istreambuf_iterator(messagesFile)),
+        (std::istreambuf_iterator<char>())
+    );
+
+    boost::system::error_code messagesError;
+    auto messages = boost::json::parse(messagesText, messagesError);
+    std::string outOfDomainMessage = "I only know about the emperors and leaders of Rome and Byzantium.";
 
-    // Initialize ASIO and TLS
-    boost::asio::io_context io_context;
-    boost::asio::ssl::context ssl_context(boost::asio::ssl::context::tlsv12_client);
+    if (auto refusal = messages.is_object() ? messages.as_object().if_contains("outOfDomain") : nullptr; refusal != nullptr && refusal->is_string())
+    {
+        outOfDomainMessage = refusal->as_string();
+    }
 
-    // Load the root certificates
-    load_root_certificates(ssl_context);
-    ssl_context.set_verify_mode(boost::asio::ssl::verify_peer);
+    // The system message is the same for every request, so it is converted to JSON once
+    std::string systemMessageJson;
+    appendMessageJson(systemMessageJson, systemMessage);
 
-    boost::asio::ip::tcp::resolver resolver(io_context);
+    // JSON of the messages sent with each request. Reused between turns to avoid reallocating them.
+    std::vector<std::string_view> conversation;
+    std::vector<ChatMessageView> historyMessages;
+    std::vector<std::string_view> historyJson;
 
     // URL to the OpenAI API
     auto openAiRequestUrl = std::string() + openAiUri + "openai/deployments/" + deployment + "/chat/completions?api-version=2023-05-15";
@@ -79,8 +291,455 @@ int main()
     std::string openAiProtocol = url->scheme();
     std::string openAiPath = url->path() + "?" + url->query();
 
-    // Resolve the domain name
-    auto const resolved_host = resolver.resolve(openAiHost, openAiProtocol);
+    // Connects to OpenAI when the first request is sent
+    OpenAiClient openAiClient(openAiHost, openAiProtocol, openAiPath, openAiKey);
+
+    // Summarises old turns in the background once the history grows past `historyLength`.
+    // Declared after the client so a summary still in flight on exit is waited for before the client is destroyed.
+    HistoryCompactor historyCompactor;
+
+    // Answers to likely follow-up questions, asked in the background within a budget of `prefetchBudget` tokens if
+    // `--prefetch` is given. Declared after the client for the same reason as the compactor.
+    Prefetcher prefetcher(prefetchBudget, maxTokens);
+
+    // Questions are embedded by the embeddings deployment if there is one, or locally otherwise
+    std::string embeddingPath;
+
+    if (embeddingDeployment != nullptr)
+    {
+        auto embeddingUrl = boost::urls::parse_uri(std::string() + openAiUri + "openai/deployments/" + embeddingDeployment + "/embeddings?api-version=2023-05-15");
+        embeddingPath = embeddingUrl->path() + "?" + embeddingUrl->query();
+    }
+
+    std::string embeddingModel = embeddingDeployment != nullptr ? embeddingDeployment : "local";
+
+    auto embed = [&](std::string_view text) {
+        auto embedding = embeddingPath.empty() ? localEmbedding(text) : extractEmbedding(openAiClient.post(embeddingPath, makeEmbeddingRequestBody(text)));
+        normalise(embedding);
+
+        return embedding;
+    };
+
+    // Threads for the CPU-bound work: embedding passages locally and searching the vector store
+    ThreadPool threadPool(std::max(threadCount, 1));
+
+    auto corpusStorePath = (std::filesystem::path(cacheDirectory) / CORPUS_VECTORS_FILE).string();
+    auto corpusIndexPath = (std::filesystem::path(cacheDirectory) / CORPUS_POSTINGS_FILE).string();
+
+    // With `--index-corpus`, split the text and Markdown files of the corpus into passages, index them and exit.
+    // Passages are only embedded for `--retrieval vector`, since that takes a request per passage.
+    if (!corpusDirectory.empty())
+    {
+        std::vector<std::string> passages;
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(corpusDirectory))
+        {
+            auto extension = entry.path().extension();
+
+            if (entry.is_regular_file() && (extension == ".txt" || extension == ".md"))
+            {
+                std::ifstream file(entry.path());
+                std::string text((std::istreambuf_iterator(file)), std::istreambuf_iterator<char>());
+
+                chunkText(text, CORPUS_CHUNK_SIZE, passages);
+            }
+        }
+
+        std::filesystem::create_directories(cacheDirectory);
+        writeLexicalIndex(corpusIndexPath, passages);
+
+        std::cout << "Indexed " << passages.size() << " passages of " << corpusDirectory << " into " << corpusIndexPath << "." << std::endl;
+
+        if (passageRetrieval == PassageRetrieval::Vector)
+        {
+            // Passages are embedded on every thread of the pool, and by as many concurrent requests
+            std::vector<std::vector<float>> embeddings(passages.size());
+
+            threadPool.parallelFor(passages.size(), [&](std::size_t i) {
+                embeddings[i] = embed(passages[i]);
+            });
+
+            std::vector<float> vectors;
+            std::size_t dimensions = embeddings.empty() ? 0 : embeddings.front().size();
+
+            for (const auto& embedding : embeddings)
+            {
+                vectors.insert(vectors.end(), embedding.begin(), embedding.end());
+            }
+
+            writeVectorStore(corpusStorePath, embeddingModel, dimensions, passages, vectors);
+
+            std::cout << "Embedded " << passages.size() << " passages of " << corpusDirectory << " into " << corpusStorePath << "." << std::endl;
+        }
+
+        return 0;
+    }
+
+    // Passages of the corpus indexed by `--index-corpus`. The most relevant ones are sent with each question.
+    std::optional<LexicalIndex> corpusIndex;
+    std::optional<VectorStore> corpusStore;
+
+    if (passageCount > 0 && passageRetrieval == PassageRetrieval::Lexical && std::filesystem::exists(corpusIndexPath))
+    {
+        try
+        {
+            corpusIndex.emplace(corpusIndexPath);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+
+    if (passageCount > 0 && passageRetrieval == PassageRetrieval::Vector && std::filesystem::exists(corpusStorePath))
+    {
+        try
+        {
+            corpusStore.emplace(corpusStorePath);
+
+            if (corpusStore->model() != embeddingModel)
+            {
+                std::cerr << "Warning: " << corpusStorePath << " was embedded with " << corpusStore->model() << ", not " << embeddingModel << ". Run --index-corpus again to use it." << std::endl;
+                corpusStore.reset();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+
+    // Return the JSON of a message with the passages most relevant to `question`, embedded as `questionEmbedding`, or nothing
+    auto retrievePassages = [&](std::string_view question, std::span<const float> questionEmbedding) {
+        std::string passagesJson;
+        std::string passages;
+
+        if (corpusIndex)
+        {
+            for (auto [score, passage] : corpusIndex->search(question, passageCount))
+            {
+                if (score < MIN_PASSAGE_SCORE)
+                {
+                    break;
+                }
+
+                passages += "\n\n";
+                passages += corpusIndex->passage(passage);
+            }
+        }
+        else if (corpusStore)
+        {
+            for (auto [similarity, passage] : corpusStore->search(questionEmbedding, passageCount, threadPool))
+            {
+                if (similarity < MIN_PASSAGE_SIMILARITY)
+                {
+                    break;
+                }
+
+                passages += "\n\n";
+                passages += corpusStore->chunk(passage);
+            }
+        }
+
+        if (!passages.empty())
+        {
+            appendMessageJson(passagesJson, { Role::System, PASSAGES_PREFIX + passages });
+        }
+
+        return passagesJson;
+    };
+
+    // With `--batch`, answer the questions of a file, each on its own without chat history, and exit.
+    // Results are printed in the order of the questions, and the throughput and latencies at the end.
+    if (!batchPath.empty())
+    {
+        BatchInput batchInput(batchPath);
+        auto questions = batchInput.questions();
+
+        // Results written to `--batch-output` are journaled, so `--resume` continues after the last checkpoint
+        std::optional<BatchOutput> batchOutput;
+        std::string journalPath = batchOutputPath + BATCH_JOURNAL_EXTENSION;
+        BatchCheckpoint resumedFrom { questions.size(), 0, 0 };
+
+        if (!batchOutputPath.empty())
+        {
+            if (auto checkpoint = resumeSession ? readBatchCheckpoint(journalPath) : std::nullopt)
+            {
+                if (checkpoint->questionCount != questions.size())
+                {
+                    std::cerr << "Error: " << journalPath << " is the journal of a batch of " << checkpoint->questionCount << " questions, not " << questions.size() << "." << std::endl;
+                    return 1;
+                }
+
+                if (!std::filesystem::exists(batchOutputPath) || std::filesystem::file_size(batchOutputPath) < checkpoint->outputOffset)
+                {
+                    std::cerr << "Error: " << batchOutputPath << " is shorter than its journal. Run the batch again without --resume." << std::endl;
+                    return 1;
+                }
+
+                // Drop what was written after the checkpoint; those questions are answered again
+                std::filesystem::resize_file(batchOutputPath, checkpoint->outputOffset);
+                resumedFrom = *checkpoint;
+
+                std::cerr << "Resuming " << batchPath << " after " << checkpoint->completedCount << " of " << questions.size() << " questions, answering again "
+                          << checkpoint->retryIndices.size() << " that failed." << std::endl;
+            }
+            else
+            {
+                // A journal left by an earlier batch does not describe the output written from now on
+                std::filesystem::remove(journalPath);
+            }
+
+            batchOutput.emplace(batchOutputPath, resumedFrom.completedCount > 0);
+        }
+        else
+        {
+            batchOutput.emplace();
+        }
+
+        BatchCheckpointer checkpoint;
+
+        if (!batchOutputPath.empty())
+        {
+            checkpoint = [&](std::size_t completedCount, std::span<const std::size_t> retryIndices, std::size_t writtenSize) {
+                writeBatchCheckpoint(journalPath, { questions.size(), completedCount, resumedFrom.outputOffset + writtenSize, { retryIndices.begin(), retryIndices.end() } });
+            };
+        }
+
+        // Questions that failed before the batch was resumed are answered first, their results written after the others
+        std::vector<std::size_t> retryIndices(resumedFrom.retryIndices.begin(), resumedFrom.retryIndices.end());
+        std::sort(retryIndices.begin(), retryIndices.end());
+
+        // The caches and the emperor index are shared by the concurrent requests
+        std::mutex batchMutex;
+
+        // With `--pack`, up to that many questions are sent in each request
+        std::optional<QuestionPacker> questionPacker;
+        std::string packingInstructionsJson;
+
+        if (packSize > 1)
+        {
+            questionPacker.emplace(packSize);
+            appendMessageJson(packingInstructionsJson, { Role::System, PACKING_INSTRUCTIONS });
+        }
+
+        auto answerQuestion = [&](std::string_view question) -> BatchAnswer {
+            if (useDomainFilter && isOutOfDomain(question))
+            {
+                std::lock_guard lock(batchMutex);
+                ++refusedQuestions;
+
+                return { outOfDomainMessage };
+            }
+
+            // Answer from the emperor index first, which needs neither the embedding nor the passages
+            {
+                std::lock_guard lock(batchMutex);
+
+                if (auto emperor = useFactIndex ? emperorIndex.findSingle(question) : nullptr)
+                {
+                    ++factAnswers;
+
+                    return { formatEmperorRecord(*emperor) };
+                }
+
+                if (auto rulers = useFactIndex ? reignTimeline.answer(question) : std::nullopt)
+                {
+                    ++factAnswers;
+
+                    return { std::move(*rulers) };
+                }
+            }
+
+            std::string questionJson;
+            appendMessageJson(questionJson, ChatMessageView { Role::User, question });
+
+            auto passagesJson = retrievePassages(question, corpusStore ? embed(question) : std::vector<float>());
+
+            // The same messages and cache key as the first question of a conversation
+            std::vector<std::string_view> batchConversation { systemMessageJson };
+
+            if (!passagesJson.empty())
+            {
+                batchConversation.push_back(passagesJson);
+            }
+
+            CacheKeyBuilder cacheKeyBuilder(deployment, completionOptions);
+
+            for (auto messageJson : batchConversation)
+            {
+                cacheKeyBuilder.add(messageJson);
+            }
+
+            cacheKeyBuilder.add(normaliseQuestion(question));
+            auto cacheKey = cacheKeyBuilder.finish();
+
+            batchConversation.push_back(questionJson);
+
+            if (useResponseCache)
+            {
+                std::lock_guard lock(batchMutex);
+
+                if (auto cachedAnswer = responseCache.find(cacheKey))
+                {
+                    return { *cachedAnswer };
+                }
+
+                if (auto storedAnswer = persistentCache ? persistentCache->find(cacheKey) : std::nullopt)
+                {
+                    responseCache.insert(cacheKey, *storedAnswer, 0);
+
+                    return { std::move(*storedAnswer) };
+                }
+            }
+
+            // Questions without passages are asked together with others, if `--pack` is set. One missing from the
+            // answer to its pack is asked again on its own.
+            std::optional<PackedAnswer> packed;
+
+            if (questionPacker && passagesJson.empty())
+            {
+                packed = questionPacker->ask(question, [&](const std::string& packedQuestions) {
+                    std::string packedJson;
+                    appendMessageJson(packedJson, ChatMessageView { Role::User, packedQuestions });
+
+                    std::vector<std::string_view> packedConversation { systemMessageJson, packingInstructionsJson, packedJson };
+
+                    return extractChatCompletion(openAiClient.post(makeChatRequestBody(deployment, packedConversation, completionOptions)));
+                });
+            }
+
+            ChatCompletion completion;
+            std::size_t responseSize;
+
+            if (packed)
+            {
+                completion = { std::move(packed->text), std::move(packed->finishReason), packed->usage };
+                responseSize = completion.content.size();
+            }
+            else
+            {
+                auto requestBody = makeChatRequestBody(deployment, batchConversation, completionOptions);
+                auto send = [&]() { return openAiClient.post(std::move(requestBody)); };
+
+                auto responseText = useResponseCache ? singleFlight.run(cacheKey, send) : send();
+                completion = extractChatCompletion(responseText);
+                responseSize = responseText.size();
+            }
+
+            std::lock_guard lock(batchMutex);
+
+            if (useResponseCache)
+            {
+                responseCache.insert(cacheKey, completion.content, responseSize);
+
+                if (persistentCache)
+                {
+                    persistentCache->insert(cacheKey, completion.content, responseSize);
+                }
+            }
+
+            if (useFactIndex)
+            {
+                emperorIndex.addAnswer(completion.content);
+                reignTimeline.rebuild();
+            }
+
+            return { std::move(completion.content), std::move(completion.finishReason), completion.usage };
+        };
+
+        auto summary = runBatch(questions, retryIndices, resumedFrom.completedCount, batchConcurrency, batchFormat, *batchOutput, answerQuestion, std::move(checkpoint));
+        auto batchError = summary.error;
+        printBatchSummary(std::cerr, std::move(summary));
+
+        if (questionPacker && questionPacker->packCount() > 0)
+        {
+            std::cerr << "Packing: " << questionPacker->packedCount() << " questions asked in " << questionPacker->packCount() << " requests, "
+                << questionPacker->packedCount() - questionPacker->answeredCount() << " asked again on their own." << std::endl;
+        }
+
+        if (batchError)
+        {
+            std::cerr << "Error: The results could not all be written: " << *batchError << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // Open the session log. Every turn is appended to it so the session can be resumed later.
+    auto sessionLogPath = sessionName.str() + SESSION_LOG_EXTENSION;
+
+    if (resumeSession && !std::filesystem::exists(sessionLogPath))
+    {
+        std::cerr << "Error: There is no session named " << sessionName.str() << " (" << sessionLogPath << ")." << std::endl;
+        return 1;
+    }
+
+    SessionLog sessionLog(sessionLogPath, fsyncPolicy);
+
+    // Create empty chat history, or rebuild it from the end of the session log when resuming.
+    // The history is a tree so the conversation can be forked to ask alternative follow-ups.
+    ConversationTree chatHistory;
+
+    // Offset in the session log of the last message of each branch, the parent of its next message
+    std::map<std::string, std::uint64_t> logTips;
+
+    if (resumeSession)
+    {
+        try
+        {
+            logTips[ConversationTree::DEFAULT_BRANCH] = SessionLog::readWindow(sessionLogPath, historyLength, chatHistory);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: The session cannot be resumed: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Embedding of the previous question, which gives the context of a semantic cache entry
+    std::vector<float> previousQuestionEmbedding;
+
+    // Fill `messages` with the JSON of the messages to send with `question` and the passages relevant to it,
+    // and return the cache key of its answer
+    auto prepareConversation = [&](std::string_view question, std::string_view passagesJson, std::string_view questionJson, std::vector<std::string_view>& messages) {
+        messages.clear();
+        messages.reserve(chatHistory.size() + 3); // Pre-allocate enought room to store the system message, chat history, passages and user message
+
+        messages.push_back(systemMessageJson);  // Add the system message to the conversation
+
+        // Add the past messages relevant to the question to the conversation
+        historyMessages.clear();
+        historyJson.clear();
+        chatHistory.appendTo(historyMessages);
+        chatHistory.appendJsonTo(historyJson);
+
+        for (auto index : selectHistory(historyMessages, question, historyTokenBudget, historySelection))
+        {
+            messages.push_back(historyJson[index]);
+        }
+
+        // Add the passages of the corpus just before the question
+        if (!passagesJson.empty())
+        {
+            messages.push_back(passagesJson);
+        }
+
+        // The answer depends on the deployment, the options, the messages sent before the question and the question itself
+        CacheKeyBuilder cacheKeyBuilder(deployment, completionOptions);
+
+        for (auto messageJson : messages)
+        {
+            cacheKeyBuilder.add(messageJson);
+        }
+
+        cacheKeyBuilder.add(normaliseQuestion(question));
+
+        messages.push_back(questionJson);  // Add the user message to the conversation
+
+        return cacheKeyBuilder.finish();
+    };
 
     // Greet the user
     std::cout << "Salve, seeker of wisdom. What would you like to know about our glorious Roman and Byzantine leaders?" << std::endl;
@@ -104,120 +763,406 @@ int main()
         {
             running = false;
         }
+        else if (userInput.starts_with("/fork "))
+        {
+            // Start a new branch from this point of the conversation
+            auto branch = userInput.substr(6);
+            auto parentBranch = chatHistory.currentBranch();
+
+            if (chatHistory.fork(branch))
+            {
+                logTips[branch] = logTips[parentBranch];
+                std::cout << "Forked the conversation into branch '" << branch << "'." << std::endl;
+            }
+            else
+            {
+                std::cout << "Branch '" << branch << "' already exists." << std::endl;
+            }
+        }
+        else if (userInput.starts_with("/switch "))
+        {
+            // Continue the conversation of another branch
+            auto branch = userInput.substr(8);
+
+            if (chatHistory.switchTo(branch))
+            {
+                previousQuestionEmbedding.clear();
+                std::cout << "Switched to branch '" << branch << "'." << std::endl;
+            }
+            else
+            {
+                std::cout << "There is no branch named '" << branch << "'." << std::endl;
+            }
+        }
+        else if (userInput == "/branches")
+        {
+            for (const auto& branch : chatHistory.branchNames())
+            {
+                std::cout << (branch == chatHistory.currentBranch() ? "* " : "  ") << branch << std::endl;
+            }
+        }
+        else if (useDomainFilter && isOutOfDomain(userInput))
+        {
+            // Refuse clearly unrelated questions without asking OpenAI. They are not added to the chat history.
+            std::cout << outOfDomainMessage << std::endl;
+            std::cout << std::endl;
+            ++refusedQuestions;
+        }
         else
         {
+            // Fold in the summary of old turns if it has arrived
+            historyCompactor.apply(chatHistory);
+
+            // Add the answers prefetched while the user was reading
+            for (const auto& result : prefetcher.collect())
+            {
+                responseCache.insert(result.key, result.answer, result.responseSize);
+                speculativeAnswers.insert(result.answer);
+
+                if (useFactIndex)
+                {
+                    emperorIndex.addAnswer(result.answer);
+                    reignTimeline.rebuild();
+
+                    // The emperor index answers with the record alone
+                    for (const auto& record : parseEmperorAnswer(result.answer))
+                    {
+                        speculativeAnswers.insert(formatEmperorRecord(record));
+                    }
+                }
+            }
+
             // Create chat message user request
-            ChatMessageRequest userRequest = {
-                ROLE_USER,
+            ChatMessageView userRequest = {
+                Role::User,
                 userInput
             };
 
-            // Create conversation history
-            std::vector<ChatMessageRequest> conversation;
-            conversation.reserve(chatHistory.size() + 2); // Pre-allocate enought room to store the system message, chat history, and user message
+            std::string userRequestJson;
+            appendMessageJson(userRequestJson, userRequest);
+
+            // Answer from the emperor index first, which needs neither the embedding nor the passages
+            std::string assistantMessage;
+            auto cached = false;
 
-            conversation.push_back(systemMessage);  // Add the system message to the conversation
-            conversation.insert(conversation.end(), chatHistory.begin(), chatHistory.end());  // Add the chat history to the conversation
-            conversation.push_back(userRequest);  // Add the user message to the conversation
+            if (auto emperor = useFactIndex ? emperorIndex.findSingle(userInput) : nullptr)
+            {
+                assistantMessage = formatEmperorRecord(*emperor);
+                cached = true;
+                ++factAnswers;
+            }
+            else if (auto rulers = useFactIndex ? reignTimeline.answer(userInput) : std::nullopt)
+            {
+                assistantMessage = std::move(*rulers);
+                cached = true;
+                ++factAnswers;
+            }
+
+            // A message too long to send at once, such as a pasted chronicle, is split into parts. Notes are taken on
+            // the parts at the same time, and the message is answered from the notes. It is neither embedded nor sent
+            // with passages, and the chat history keeps the notes rather than the whole message.
+            auto mapReduce = estimateTokens(userInput) > MAP_REDUCE_THRESHOLD_TOKENS;
+            auto historyInput = mapReduce ? reduceMessage(userInput, {}) : std::string();
 
-            // Convert to JSON array
-            boost::json::array conversationJson;
+            // Otherwise embed the question to find similar questions and relevant passages
+            std::vector<float> questionEmbedding;
 
-            for (auto [role, content] : conversation)
+            if (!cached && !mapReduce && (useSemanticCache || corpusStore))
             {
-                conversationJson.push_back({
-                    {"role", role},
-                    {"content", content}
-                });
+                questionEmbedding = embed(userInput);
             }
 
-            // Create the OpenAI request body
-            boost::json::object requestBodyJson = {
-                // Name of the deployment
-                {"model", deployment},
-                // The conversation history
-                {"messages", conversationJson},
-                // The maximum number of tokens to generate
-                {"max_tokens", maxTokens},
-                // The number of responses to generate
-                {"n", 1},
-
-                // The next set of parameters are optional and include as example with their default values.
-                {"temperature", 1.0},
-                {"top_p", 1.0},
-                {"presence_penalty", 0.0},
-                {"frequency_penalty", 0.0},
-            };
+            auto passagesJson = cached || mapReduce ? std::string() : retrievePassages(userInput, questionEmbedding);
 
-            // Convert JSON body to string
-            std::string requestBody = serialize(requestBodyJson);
+            // Create conversation history from the JSON of the messages
+            auto cacheKey = prepareConversation(userInput, passagesJson, userRequestJson, conversation);
 
-            // This section is low level and may seem a bit messy
-            // In production code, an HTTP client and OpenSSL or a similar library would be used to simplify this request
+            // Reuse the answer to the same request, or send the request to OpenAI
+            if (!cached && useResponseCache)
+            {
+                if (auto cachedAnswer = responseCache.find(cacheKey))
+                {
+                    assistantMessage = *cachedAnswer;
+                    cached = true;
+                }
+                else if (auto storedAnswer = persistentCache ? persistentCache->find(cacheKey) : std::nullopt)
+                {
+                    assistantMessage = std::move(*storedAnswer);
+                    responseCache.insert(cacheKey, assistantMessage, 0);
+                    cached = true;
+                }
+            }
 
-            // Create TLS stream.
-            boost::beast::ssl_stream<boost::beast::tcp_stream> stream(io_context, ssl_context);
+            // Reuse the answer to a question with the same meaning
+            if (useSemanticCache && !cached && !mapReduce)
+            {
+                if (auto similarAnswer = semanticCache.find(questionEmbedding, previousQuestionEmbedding))
+                {
+                    assistantMessage = std::move(*similarAnswer);
+                    cached = true;
+                }
+            }
 
-            // Set SNI Hostname (many hosts need this to handshake successfully)
-            if(!SSL_set_tlsext_host_name(stream.native_handle(), openAiHost.c_str()))
+            // Count the questions answered thanks to a prefetched answer
+            if (cached && speculativeAnswers.erase(assistantMessage) > 0)
             {
-                std::cerr << "Error: Failed to set SNI hostname for SSL connection." << std::endl;
+                ++speculativeHits;
             }
 
-            // Make the connection on the IP address we get from a lookup
-            boost::beast::get_lowest_layer(stream).connect(resolved_host);
+            if (!cached)
+            {
+                std::size_t responseSize = 0;
+
+                // A question asking the same thing about several known emperors is split into a question about each,
+                // asked at the same time, and their answers are merged into the numbered form
+                auto fanOut = !mapReduce && useFactIndex && useFanOut && asksAboutEach(userInput, emperorIndex);
+                auto entities = fanOut ? emperorIndex.findAll(userInput) : std::vector<const EmperorRecord*>();
 
-            // Perform the SSL handshake
-            stream.handshake(ssl::stream_base::client);
+                if (mapReduce)
+                {
+                    auto chunks = splitChunks(userInput, MAP_CHUNK_TOKENS);
 
-            // Set up an HTTP POST request message
-            boost::beast::http::request<boost::beast::http::string_body> req {
-                boost::beast::http::verb::post,
-                openAiPath,
-                11  // HTTP/1.1
-            };
-            req.set(boost::beast::http::field::host, openAiHost);
-            req.set("api-key", openAiKey);
-            req.body().assign(requestBody);
-            req.chunked(true);
+                    std::string mapInstructionsJson;
+                    appendMessageJson(mapInstructionsJson, { Role::System, MAP_INSTRUCTIONS });
+
+                    std::atomic<std::size_t> mapResponseSize = 0;
+
+                    auto notes = mapConcurrently(chunks.size(), MAP_CONCURRENCY, [&](std::size_t i) {
+                        std::string chunkJson;
+                        appendMessageJson(chunkJson, ChatMessageView { Role::User, chunks[i] });
+
+                        std::vector<std::string_view> mapConversation { systemMessageJson, mapInstructionsJson, chunkJson };
+                        auto responseText = openAiClient.post(makeChatRequestBody(deployment, mapConversation, completionOptions));
+                        mapResponseSize += responseText.size();
+
+                        return extractAssistantMessage(responseText);
+                    });
+
+                    // The notes replace the message in the conversation prepared for it, after the history
+                    std::string reduceInstructionsJson;
+                    appendMessageJson(reduceInstructionsJson, { Role::System, REDUCE_INSTRUCTIONS });
+
+                    historyInput = reduceMessage(userInput, notes);
+
+                    std::string reduceJson;
+                    appendMessageJson(reduceJson, ChatMessageView { Role::User, historyInput });
+
+                    conversation.back() = reduceInstructionsJson;
+                    conversation.push_back(reduceJson);
+
+                    auto responseText = openAiClient.post(makeChatRequestBody(deployment, conversation, completionOptions));
+                    assistantMessage = extractAssistantMessage(responseText);
+                    responseSize = mapResponseSize + responseText.size();
+
+                    ++mapReduceQuestions;
+                    mapRequests += chunks.size();
+                }
+                else if (entities.size() >= 2 && entities.size() <= MAX_FAN_OUT)
+                {
+                    std::vector<CacheKey> entityKeys;
+                    std::vector<std::string> entityBodies;
+                    std::vector<std::string> entityAnswers(entities.size());
+                    std::vector<std::string_view> entityConversation;
+
+                    // Prepare every request first: the conversation is rebuilt from the history each time
+                    for (std::size_t i = 0; i < entities.size(); ++i)
+                    {
+                        auto question = entityQuestion(userInput, *entities[i]);
+
+                        std::string questionJson;
+                        appendMessageJson(questionJson, ChatMessageView { Role::User, question });
+
+                        auto entityPassagesJson = retrievePassages(question, corpusStore ? embed(question) : std::vector<float>());
+                        entityKeys.push_back(prepareConversation(question, entityPassagesJson, questionJson, entityConversation));
+                        entityBodies.push_back(makeChatRequestBody(deployment, entityConversation, completionOptions));
+
+                        if (useResponseCache)
+                        {
+                            if (auto cachedAnswer = responseCache.find(entityKeys[i]))
+                            {
+                                entityAnswers[i] = *cachedAnswer;
+                            }
+                            else if (auto storedAnswer = persistentCache ? persistentCache->find(entityKeys[i]) : std::nullopt)
+                            {
+                                entityAnswers[i] = std::move(*storedAnswer);
+                                responseCache.insert(entityKeys[i], entityAnswers[i], 0);
+                            }
+                        }
+                    }
+
+                    auto responses = answerConcurrently(entities.size(), [&](std::size_t i) -> std::string {
+                        if (!entityAnswers[i].empty())
+                        {
+                            return {};
+                        }
 
-            // Send the HTTP request to the remote host
-            boost::beast::http::write(stream, req);
+                        auto send = [&]() { return openAiClient.post(entityBodies[i]); };
 
-            // This buffer is used for reading and must be persisted
-            boost::beast::flat_buffer buffer;
+                        return useResponseCache ? singleFlight.run(entityKeys[i], send) : send();
+                    });
 
-            // Declare a container to hold the response
-            boost::beast::http::response<boost::beast::http::string_body> httpResponse;
+                    for (std::size_t i = 0; i < entities.size(); ++i)
+                    {
+                        if (responses[i].empty())
+                        {
+                            continue;
+                        }
 
-            // Receive the HTTP response
-            boost::beast::http::read(stream, buffer, httpResponse);
+                        entityAnswers[i] = extractAssistantMessage(responses[i]);
+                        responseSize += responses[i].size();
+                        ++fanOutRequests;
 
-            // Get the text of the body.
-            std::string responseText = httpResponse.body();
+                        if (useResponseCache)
+                        {
+                            responseCache.insert(entityKeys[i], entityAnswers[i], responses[i].size());
 
-            // Read the JSON response
-            auto responseJson = boost::json::parse(responseText);
+                            if (persistentCache)
+                            {
+                                persistentCache->insert(entityKeys[i], entityAnswers[i], responses[i].size());
+                            }
+                        }
+                    }
 
-            // Extract the assistant message
-            auto pointer = responseJson.at_pointer("/choices/0/message/content");
-            auto assistantMessage = pointer.get_string().c_str();
+                    assistantMessage = mergeEntityAnswers(entityAnswers);
+                    ++fanOutQuestions;
+                }
+                else
+                {
+                    auto requestBody = makeChatRequestBody(deployment, conversation, completionOptions);
+                    auto send = [&]() { return openAiClient.post(std::move(requestBody)); };
+
+                    // Requests whose answer may be shared are coalesced with identical ones in flight
+                    auto responseText = useResponseCache ? singleFlight.run(cacheKey, send) : send();
+                    assistantMessage = extractAssistantMessage(responseText);
+                    responseSize = responseText.size();
+                }
+
+                if (useResponseCache)
+                {
+                    responseCache.insert(cacheKey, assistantMessage, responseSize);
+
+                    if (persistentCache)
+                    {
+                        persistentCache->insert(cacheKey, assistantMessage, responseSize);
+                    }
+                }
+
+                if (useFactIndex)
+                {
+                    emperorIndex.addAnswer(assistantMessage);
+                    reignTimeline.rebuild();
+                }
+
+                if (useSemanticCache && !mapReduce)
+                {
+                    semanticCache.insert(questionEmbedding, previousQuestionEmbedding, assistantMessage);
+                }
+            }
 
             // Print the assistant message
             std::cout << assistantMessage << std::endl;
             std::cout << std::endl;  // Blank line after response.
 
-            // Add assistant message to chat history
-            chatHistory.push_back({ ROLE_ASSISTANT, assistantMessage });
+            // Add the user and assistant messages to chat history
+            ChatMessageView historyRequest = mapReduce ? ChatMessageView { Role::User, historyInput } : userRequest;
 
-            // Trim chat history to the last `historyLength` messages
+            chatHistory.push(Role::User, historyRequest.content);
+            chatHistory.push(Role::Assistant, assistantMessage);
+
+            auto& logTip = logTips[chatHistory.currentBranch()];
+            logTip = sessionLog.append(historyRequest, logTip);
+            logTip = sessionLog.append({ Role::Assistant, assistantMessage }, logTip);
+
+            previousQuestionEmbedding = std::move(questionEmbedding);
+
+            // Once the chat history exceeds `historyLength` messages, summarise all but the most recent `historyLength / 2` in the background
             if (chatHistory.size() > historyLength)
             {
-                // Remove the top two messages
-                chatHistory.erase(chatHistory.begin()+2, chatHistory.end());
+                historyCompactor.start(chatHistory, chatHistory.size() - historyLength / 2, [&](std::span<const ChatMessageView> summaryConversation) {
+                    auto summaryBody = makeChatRequestBody(deployment, summaryConversation, summaryOptions);
+
+                    return extractAssistantMessage(openAiClient.post(std::move(summaryBody)));
+                });
+            }
+
+            // Compress the messages of the other branches while the user reads the answer
+            chatHistory.compressCold();
+
+            // Ask the likely follow-up questions in the background while the user reads the answer. Their cache keys
+            // include the history, so none is asked while a summary may replace old turns before the next question.
+            if (prefetchBudget > 0 && useResponseCache && !historyCompactor.pending())
+            {
+                std::vector<PrefetchRequest> prefetchRequests;
+                std::vector<std::string_view> prefetchConversation;
+
+                for (auto& question : likelyFollowUps(assistantMessage, reignTimeline))
+                {
+                    std::string questionJson;
+                    appendMessageJson(questionJson, ChatMessageView { Role::User, question });
+
+                    auto followUpPassagesJson = retrievePassages(question, corpusStore ? embed(question) : std::vector<float>());
+                    auto key = prepareConversation(question, followUpPassagesJson, questionJson, prefetchConversation);
+
+                    if (!responseCache.contains(key))
+                    {
+                        prefetchRequests.push_back({ key, std::move(question), makeChatRequestBody(deployment, prefetchConversation, completionOptions) });
+                    }
+                }
+
+                prefetcher.start(std::move(prefetchRequests), [&](const PrefetchRequest& request) {
+                    return singleFlight.run(request.key, [&]() { return openAiClient.post(request.body); });
+                });
             }
         }
     }
 
+    if (responseCache.lookupCount() > 0)
+    {
+        std::cout << "Response cache: " << responseCache.hitCount() << " of " << responseCache.lookupCount() << " questions answered from the cache ("
+                  << static_cast<int>(responseCache.hitRatio() * 100.0) << "%), " << responseCache.bytesSavedCount() << " bytes saved." << std::endl;
+
+        if (persistentCache)
+        {
+            std::cout << "Persistent cache: " << persistentCache->hitCount() << " questions answered from " << cacheDirectory << "." << std::endl;
+        }
+    }
+
+    if (semanticCache.lookupCount() > 0)
+    {
+        std::cout << "Semantic cache: " << semanticCache.hitCount() << " of " << semanticCache.lookupCount() << " questions answered by a similar question." << std::endl;
+    }
+
+    if (factAnswers > 0)
+    {
+        std::cout << "Emperor index: " << factAnswers << " questions answered from the " << emperorIndex.size() << " emperors already described." << std::endl;
+    }
+
+    if (singleFlight.coalescedCount() > 0)
+    {
+        std::cout << "Single flight: " << singleFlight.coalescedCount() << " requests shared the response of an identical request." << std::endl;
+    }
+
+    if (fanOutQuestions > 0)
+    {
+        std::cout << "Fan-out: " << fanOutQuestions << " questions about several emperors answered by " << fanOutRequests << " requests sent at the same time." << std::endl;
+    }
+
+    if (mapReduceQuestions > 0)
+    {
+        std::cout << "Map-reduce: " << mapReduceQuestions << " long messages answered from notes on " << mapRequests << " parts." << std::endl;
+    }
+
+    if (prefetcher.fetchedCount() > 0)
+    {
+        std::cout << "Prefetch: " << speculativeHits << " of " << prefetcher.fetchedCount() << " prefetched answers used ("
+                  << speculativeHits * 100 / prefetcher.fetchedCount() << "%), about " << prefetcher.spentTokens() << " of " << prefetchBudget << " tokens spent." << std::endl;
+    }
+
+    if (refusedQuestions > 0)
+    {
+        std::cout << "Domain filter: " << refusedQuestions << " unrelated questions refused without a request." << std::endl;
+    }
+
+    std::cout << "To continue this conversation later, run: MagnusLiber --resume " << sessionName.str() << std::endl;
     std::cout << "Vale et gratias tibi ago for using Magnus Liber Imperatorum." << std::endl;
 }
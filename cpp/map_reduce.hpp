@@ -0,0 +1,162 @@
+#ifndef MAGNUS_LIBER_MAP_REDUCE_HPP
+#define MAGNUS_LIBER_MAP_REDUCE_HPP
+
+#include "history_selector.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// A question longer than this is answered by map-reduce rather than sent at once
+constexpr std::size_t MAP_REDUCE_THRESHOLD_TOKENS = 6000;
+
+// Most tokens of a part of the question sent with each map request
+constexpr std::size_t MAP_CHUNK_TOKENS = 3000;
+
+// Most map requests sent at the same time
+constexpr std::size_t MAP_CONCURRENCY = 4;
+
+// How much of the start of the question is repeated with the notes, so the reduce request knows what was asked
+constexpr std::size_t REDUCE_EXCERPT_SIZE = 1000;
+
+// Sent with each part of the question
+constexpr auto MAP_INSTRUCTIONS = "The user's message is too long to answer at once, so it is given to you in parts. "
+    "Do not answer it yet. From the part below, write brief notes of every emperor it mentions, the dates of their reigns "
+    "and the facts needed to answer the message. Only write what the part says.";
+
+// Sent with the notes on every part
+constexpr auto REDUCE_INSTRUCTIONS = "The user's message was too long to send at once. Notes on each of its parts follow its start. "
+    "Answer the message from the notes.";
+
+// The largest size up to `size` that does not cut `text` within the bytes of a UTF-8 character, which would make
+// the JSON of the part invalid. Continuation bytes are 0b10xxxxxx. Text that is not UTF-8 is cut at `size`.
+inline std::size_t utf8Boundary(std::string_view text, std::size_t size)
+{
+    if (size >= text.size())
+    {
+        return text.size();
+    }
+
+    auto boundary = size;
+
+    while (boundary > 0 && (static_cast<unsigned char>(text[boundary]) & 0xC0) == 0x80)
+    {
+        --boundary;
+    }
+
+    return boundary > 0 ? boundary : size;
+}
+
+// Split `text` into parts of at most `maxTokens` tokens, views into `text` rather than copies.
+// Parts end at a paragraph if there is one in their second half, else at a line, a sentence or a word.
+inline std::vector<std::string_view> splitChunks(std::string_view text, std::size_t maxTokens)
+{
+    // The inverse of estimateTokens
+    auto maxSize = std::max<std::size_t>(maxTokens, 8) * 4 - 16;
+    std::vector<std::string_view> chunks;
+
+    while (!text.empty())
+    {
+        auto size = text.size();
+
+        if (size > maxSize)
+        {
+            auto window = text.substr(0, maxSize);
+            size = utf8Boundary(text, maxSize);
+
+            for (std::string_view separator : { "\n\n", "\n", ". ", " " })
+            {
+                auto found = window.rfind(separator);
+
+                if (found != std::string_view::npos && found >= maxSize / 2)
+                {
+                    size = found + separator.size();
+                    break;
+                }
+            }
+        }
+
+        chunks.push_back(text.substr(0, size));
+        text.remove_prefix(size);
+    }
+
+    return chunks;
+}
+
+// Call `map` with the index of each of `count` parts, at most `concurrency` at a time, and return the results in
+// order. The calling thread maps parts too. The first exception thrown is rethrown once all are done.
+template<typename Map>
+std::vector<std::string> mapConcurrently(std::size_t count, std::size_t concurrency, Map map)
+{
+    std::vector<std::string> results(count);
+    std::atomic<std::size_t> next = 0;
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto work = [&]() {
+        for (auto index = next++; index < count; index = next++)
+        {
+            try
+            {
+                results[index] = map(index);
+            }
+            catch (...)
+            {
+                std::lock_guard lock(errorMutex);
+
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+
+        for (std::size_t i = 1; i < std::min(std::max<std::size_t>(concurrency, 1), count); ++i)
+        {
+            workers.emplace_back(work);
+        }
+
+        work();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return results;
+}
+
+// The user message of the reduce request: the start of `text` and the `notes` on each of its parts
+inline std::string reduceMessage(std::string_view text, std::span<const std::string> notes)
+{
+    std::string message = "Start of the message:\n";
+
+    message += text.substr(0, utf8Boundary(text, REDUCE_EXCERPT_SIZE));
+
+    if (text.size() > REDUCE_EXCERPT_SIZE)
+    {
+        message += "...";
+    }
+
+    for (std::size_t i = 0; i < notes.size(); ++i)
+    {
+        message += "\n\nNotes on part " + std::to_string(i + 1) + " of " + std::to_string(notes.size()) + ":\n";
+        message += notes[i];
+    }
+
+    return message;
+}
+
+#endif //MAGNUS_LIBER_MAP_REDUCE_HPP
@@ -0,0 +1,138 @@
+#ifndef MAGNUS_LIBER_MAPPED_FILE_HPP
+#define MAGNUS_LIBER_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Failed to open " + path);
+        }
+
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        mappedSize = static_cast<std::size_t>(fileSize.QuadPart);
+
+        if (mappedSize > 0)
+        {
+            auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            mappedData = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+        }
+
+        CloseHandle(file);
+#else
+        auto file = ::open(path.c_str(), O_RDONLY);
+
+        if (file < 0)
+        {
+            throw std::runtime_error("Failed to open " + path);
+        }
+
+        struct stat fileStat {};
+        ::fstat(file, &fileStat);
+        mappedSize = static_cast<std::size_t>(fileStat.st_size);
+
+        if (mappedSize > 0)
+        {
+            auto address = ::mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, file, 0);
+            mappedData = address == MAP_FAILED ? nullptr : static_cast<const char*>(address);
+        }
+
+        ::close(file);
+#endif
+
+        if (mappedSize > 0 && mappedData == nullptr)
+        {
+            throw std::runtime_error("Failed to map " + path);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : mappedData(std::exchange(other.mappedData, nullptr)), mappedSize(std::exchange(other.mappedSize, 0))
+    {
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            mappedData = std::exchange(other.mappedData, nullptr);
+            mappedSize = std::exchange(other.mappedSize, 0);
+        }
+
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        unmap();
+    }
+
+    const char* data() const
+    {
+        return mappedData;
+    }
+
+    std::size_t size() const
+    {
+        return mappedSize;
+    }
+
+    std::string_view view() const
+    {
+        return { mappedData, mappedSize };
+    }
+
+private:
+    void unmap()
+    {
+        if (mappedData != nullptr)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(mappedData);
+#else
+            ::munmap(const_cast<char*>(mappedData), mappedSize);
+#endif
+        }
+
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+
+    const char* mappedData = nullptr;
+    std::size_t mappedSize = 0;
+};
+
+#endif //MAGNUS_LIBER_MAPPED_FILE_HPP
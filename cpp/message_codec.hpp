@@ -0,0 +1,106 @@
+#ifndef MAGNUS_LIBER_MESSAGE_CODEC_HPP
+#define MAGNUS_LIBER_MESSAGE_CODEC_HPP
+
+#include <zstd.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Dictionary used to compress messages.
+// Chat messages are short, so on their own they compress poorly. Zstandard can prime the compressor with
+// any text (a "raw content" dictionary): this one holds the phrases every answer in the format of
+// `SystemMessage.txt` repeats. The text most likely to match is kept at the end, where references are cheapest.
+constexpr std::string_view MESSAGE_DICTIONARY =
+    "Magnus Liber Imperatorum. Roman and Byzantine Emperors and leaders. "
+    "Who was the first emperor? Who followed him? Who were the five great emperors? Tell me about "
+    "Augustus (Imperator Caesar Divi Filius Augustus) Tiberius (Tiberius Caesar Augustus) Caligula (Gaius Caesar Augustus Germanicus) "
+    "Claudius (Tiberius Claudius Caesar Augustus Germanicus) Nero (Nero Claudius Caesar Augustus Germanicus) "
+    "Vespasian (Titus Flavius Vespasianus) Titus (Titus Flavius Vespasianus) Domitian (Titus Flavius Domitianus) "
+    "Nerva (Marcus Cocceius Nerva) Trajan (Marcus Ulpius Traianus) Hadrian (Publius Aelius Hadrianus) "
+    "Antoninus Pius (Titus Aelius Hadrianus Antoninus Pius) Marcus Aurelius (Marcus Aurelius Antoninus) "
+    "Commodus (Lucius Aurelius Commodus) Septimius Severus (Lucius Septimius Severus) Caracalla (Marcus Aurelius Antoninus) "
+    "Diocletian (Gaius Aurelius Valerius Diocletianus) Constantine the Great (Flavius Valerius Constantinus) "
+    "Theodosius I (Flavius Theodosius) Justinian I (Flavius Petrus Sabbatius Iustinianus) Heraclius (Flavius Heraclius) "
+    "Basil II (Basileios II) Alexios I Komnenos (Alexios Komnenos) Constantine XI Palaiologos (Konstantinos Palaiologos) "
+    "the Roman Empire, the Senate, the Praetorian Guard, the legions, the Western Roman Empire, the Eastern Roman Empire, "
+    "the Byzantine Empire, Constantinople, Rome, the provinces, the frontier, the Rhine, the Danube, the Persians, "
+    "He was known for his military campaigns, his building programme, his reforms of the administration and the army. "
+    "He was assassinated. He died of illness. He was proclaimed emperor by his troops. He was the son of the emperor. "
+    " BC, AD, century, dynasty, Julio-Claudian, Flavian, Nerva-Antonine, Severan, Constantinian, Theodosian, Justinian, "
+    "Heraclian, Macedonian, Komnenian, Palaiologan, "
+    "\n1 - \n2 - \n3 - \n4 - \n5 - "
+    "\nStart of reign: January AD \nEnd of reign: AD \nStart of reign: 27 BC\nEnd of reign: AD 14\n"
+    "Start of reign: \nEnd of reign: ";
+
+// Compresses chat messages with Zstandard and `MESSAGE_DICTIONARY`.
+// Each message is an independent frame so any one can be decompressed on its own.
+class MessageCodec
+{
+public:
+    MessageCodec()
+        : compressionContext(ZSTD_createCCtx()),
+          decompressionContext(ZSTD_createDCtx()),
+          compressionDictionary(ZSTD_createCDict(MESSAGE_DICTIONARY.data(), MESSAGE_DICTIONARY.size(), COMPRESSION_LEVEL)),
+          decompressionDictionary(ZSTD_createDDict(MESSAGE_DICTIONARY.data(), MESSAGE_DICTIONARY.size()))
+    {
+    }
+
+    MessageCodec(const MessageCodec&) = delete;
+    MessageCodec& operator=(const MessageCodec&) = delete;
+
+    ~MessageCodec()
+    {
+        ZSTD_freeDDict(decompressionDictionary);
+        ZSTD_freeCDict(compressionDictionary);
+        ZSTD_freeDCtx(decompressionContext);
+        ZSTD_freeCCtx(compressionContext);
+    }
+
+    // Append the compressed frame of `text` to `out`
+    void compress(std::string_view text, std::string& out)
+    {
+        auto start = out.size();
+        out.resize(start + ZSTD_compressBound(text.size()));
+
+        auto size = ZSTD_compress_usingCDict(compressionContext, out.data() + start, out.size() - start, text.data(), text.size(), compressionDictionary);
+
+        if (ZSTD_isError(size))
+        {
+            throw std::runtime_error(std::string("Failed to compress message: ") + ZSTD_getErrorName(size));
+        }
+
+        out.resize(start + size);
+    }
+
+    // Append the text of the compressed `frame` to `out`
+    void decompress(std::string_view frame, std::string& out)
+    {
+        auto contentSize = ZSTD_getFrameContentSize(frame.data(), frame.size());
+
+        if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN)
+        {
+            throw std::runtime_error("Failed to decompress message: invalid frame");
+        }
+
+        auto start = out.size();
+        out.resize(start + contentSize);
+
+        auto size = ZSTD_decompress_usingDDict(decompressionContext, out.data() + start, contentSize, frame.data(), frame.size(), decompressionDictionary);
+
+        if (ZSTD_isError(size))
+        {
+            throw std::runtime_error(std::string("Failed to decompress message: ") + ZSTD_getErrorName(size));
+        }
+    }
+
+private:
+    static constexpr int COMPRESSION_LEVEL = 9;
+
+    ZSTD_CCtx* compressionContext;
+    ZSTD_DCtx* decompressionContext;
+    ZSTD_CDict* compressionDictionary;
+    ZSTD_DDict* decompressionDictionary;
+};
+
+#endif //MAGNUS_LIBER_MESSAGE_CODEC_HPP
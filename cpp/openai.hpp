@@ -0,0 +1,469 @@
+#ifndef MAGNUS_LIBER_OPENAI_HPP
+#define MAGNUS_LIBER_OPENAI_HPP
+
+#include "root_certificates.hpp"
+
+#include "boost/asio.hpp"
+#include "boost/asio/ssl.hpp"
+#include "boost/beast.hpp"
+#include "boost/beast/ssl.hpp"
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Since the C++ SDK for OpenAI is not yet available, we will reproduce some basic data structures here.
+
+// The chat message request roles
+enum class Role : std::uint8_t
+{
+    System,
+    User,
+    Assistant,
+
+    // The following chat roles are not used in the demo but included for completion
+    Tool,
+    Function,
+};
+
+// Name of each role in a request, indexed by `Role`
+constexpr std::string_view ROLE_NAMES[] = { "system", "user", "assistant", "tool", "function" };
+
+constexpr std::string_view roleName(Role role)
+{
+    return ROLE_NAMES[static_cast<std::size_t>(role)];
+}
+
+// A non-owning view of an OpenAI chat message request.
+// Message text is owned by the chat history; the conversation sent with each request is assembled from views.
+struct ChatMessageView
+{
+    Role role;
+    std::string_view content;
+};
+
+// Parameters of a chat completion request
+struct ChatCompletionOptions
+{
+    // The maximum number of tokens to generate
+    int maxTokens = 1500;
+
+    // The next set of parameters are optional and include as example with their default values.
+    double temperature = 1.0;
+    double topP = 1.0;
+    double presencePenalty = 0.0;
+    double frequencyPenalty = 0.0;
+};
+
+// Append `text` to `out` as a quoted JSON string
+inline void appendJsonString(std::string& out, std::string_view text)
+{
+    constexpr char hexDigits[] = "0123456789abcdef";
+
+    out += '"';
+
+    for (auto c : text)
+    {
+        switch (c)
+        {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    out += "\\u00";
+                    out += hexDigits[(c >> 4) & 0x0f];
+                    out += hexDigits[c & 0x0f];
+                }
+                else
+                {
+                    out += c;
+                }
+        }
+    }
+
+    out += '"';
+}
+
+// Append `,"name":value` to `out`
+inline void appendJsonNumber(std::string& out, std::string_view name, double value)
+{
+    char digits[32];
+    auto end = std::to_chars(std::begin(digits), std::end(digits), value).ptr;
+
+    out += ",\"";
+    out += name;
+    out += "\":";
+    out.append(digits, end);
+}
+
+// Append the JSON object of a chat message to `out`
+inline void appendMessageJson(std::string& out, ChatMessageView message)
+{
+    out += "{\"role\":\"";
+    out += roleName(message.role);
+    out += "\",\"content\":";
+    appendJsonString(out, message.content);
+    out += '}';
+}
+
+// Create the body of a chat completion request from messages already converted with `appendMessageJson`.
+// The JSON of each message is copied as is, so messages that are sent again and again are only escaped once.
+inline std::string makeChatRequestBody(std::string_view deployment, std::span<const std::string_view> messagesJson, const ChatCompletionOptions& options)
+{
+    std::string requestBody;
+
+    // Pre-allocate enough room for the messages and the rest of the request
+    std::size_t size = 256 + deployment.size();
+
+    for (auto messageJson : messagesJson)
+    {
+        size += 1 + messageJson.size();
+    }
+
+    requestBody.reserve(size);
+
+    // Name of the deployment
+    requestBody += "{\"model\":";
+    appendJsonString(requestBody, deployment);
+
+    // The conversation history
+    requestBody += ",\"messages\":[";
+
+    for (auto messageJson : messagesJson)
+    {
+        if (requestBody.back() != '[')
+        {
+            requestBody += ',';
+        }
+
+        requestBody += messageJson;
+    }
+
+    // The maximum number of tokens to generate
+    requestBody += "],\"max_tokens\":";
+    requestBody += std::to_string(options.maxTokens);
+
+    // The number of responses to generate
+    requestBody += ",\"n\":1";
+
+    // The sampling parameters
+    appendJsonNumber(requestBody, "temperature", options.temperature);
+    appendJsonNumber(requestBody, "top_p", options.topP);
+    appendJsonNumber(requestBody, "presence_penalty", options.presencePenalty);
+    appendJsonNumber(requestBody, "frequency_penalty", options.frequencyPenalty);
+
+    requestBody += '}';
+
+    return requestBody;
+}
+
+// Create the body of a chat completion request from views of the messages
+inline std::string makeChatRequestBody(std::string_view deployment, std::span<const ChatMessageView> conversation, const ChatCompletionOptions& options)
+{
+    std::string messagesText;
+    std::vector<std::size_t> ends;
+
+    for (auto message : conversation)
+    {
+        appendMessageJson(messagesText, message);
+        ends.push_back(messagesText.size());
+    }
+
+    std::vector<std::string_view> messagesJson;
+    std::size_t start = 0;
+
+    for (auto end : ends)
+    {
+        messagesJson.push_back(std::string_view(messagesText).substr(start, end - start));
+        start = end;
+    }
+
+    return makeChatRequestBody(deployment, std::span<const std::string_view>(messagesJson), options);
+}
+
+// Sends requests to the deployments of an OpenAI resource.
+// The TLS context, the root certificates and the address of the host are only set up when the first request
+// is sent, so a run answered entirely from the caches never touches the network.
+// Connections are kept alive and reused by later requests, which saves a TCP and TLS handshake per request.
+// A thread gets back the connection it used last when it is still idle, so its TLS state stays in that
+// thread's cache.
+class OpenAiClient
+{
+public:
+    OpenAiClient(std::string host, std::string protocol, std::string path, std::string key)
+        : host(std::move(host)), protocol(std::move(protocol)), path(std::move(path)), key(std::move(key))
+    {
+    }
+
+    // Send a chat completion request and return the text of the response body.
+    // Each call uses its own connection, so it is safe to call from several threads.
+    std::string post(std::string requestBody)
+    {
+        return post(path, std::move(requestBody));
+    }
+
+    // Send a request to another endpoint of the same host, such as the embeddings of another deployment
+    std::string post(const std::string& requestPath, std::string requestBody)
+    {
+        std::call_once(connected, [this]() { connect(); });
+
+        // Set up an HTTP POST request message
+        boost::beast::http::request<boost::beast::http::string_body> req {
+            boost::beast::http::verb::post,
+            requestPath,
+            11  // HTTP/1.1
+        };
+        req.set(boost::beast::http::field::host, host);
+        req.set("api-key", key);
+        req.keep_alive(true);
+        req.body() = std::move(requestBody);
+        req.chunked(true);
+
+        // An idle connection may have been closed by the server in the meantime: retry once on a new one
+        auto connection = takeConnection();
+        auto reused = connection != nullptr;
+
+        while (true)
+        {
+            if (connection == nullptr)
+            {
+                connection = openConnection();
+            }
+
+            try
+            {
+                // Send the HTTP request to the remote host
+                boost::beast::http::write(connection->stream, req);
+
+                // This buffer is used for reading and must be persisted
+                boost::beast::flat_buffer buffer;
+
+                // Declare a container to hold the response
+                boost::beast::http::response<boost::beast::http::string_body> httpResponse;
+
+                // Receive the HTTP response
+                boost::beast::http::read(connection->stream, buffer, httpResponse);
+
+                if (httpResponse.keep_alive())
+                {
+                    returnConnection(std::move(connection));
+                }
+
+                // Get the text of the body.
+                return std::move(httpResponse.body());
+            }
+            catch (const boost::system::system_error&)
+            {
+                if (!reused)
+                {
+                    throw;
+                }
+
+                connection.reset();
+                reused = false;
+            }
+        }
+    }
+
+private:
+    // A TLS connection to the host, with its own I/O context so it can be used from any thread
+    struct Connection
+    {
+        explicit Connection(boost::asio::ssl::context& sslContext)
+            : stream(ioContext, sslContext)
+        {
+        }
+
+        boost::asio::io_context ioContext;
+        boost::beast::ssl_stream<boost::beast::tcp_stream> stream;
+    };
+
+    // Idle connections beyond this number are closed
+    static constexpr std::size_t MAX_IDLE_CONNECTIONS = 64;
+
+    std::unique_ptr<Connection> openConnection()
+    {
+        // This section is low level and may seem a bit messy
+        // In production code, an HTTP client and OpenSSL or a similar library would be used to simplify this request
+        auto connection = std::make_unique<Connection>(*sslContext);
+
+        // Set SNI Hostname (many hosts need this to handshake successfully)
+        if(!SSL_set_tlsext_host_name(connection->stream.native_handle(), host.c_str()))
+        {
+            std::cerr << "Error: Failed to set SNI hostname for SSL connection." << std::endl;
+        }
+
+        // Make the connection on the IP address we get from a lookup
+        boost::beast::get_lowest_layer(connection->stream).connect(resolvedHost);
+
+        // Perform the SSL handshake
+        connection->stream.handshake(boost::asio::ssl::stream_base::client);
+
+        return connection;
+    }
+
+    // Return the idle connection last used by this thread, another idle connection, or nothing if there is none
+    std::unique_ptr<Connection> takeConnection()
+    {
+        std::lock_guard lock(poolMutex);
+
+        if (idleConnections.empty())
+        {
+            return nullptr;
+        }
+
+        auto idle = std::find_if(idleConnections.rbegin(), idleConnections.rend(), [](const auto& entry) {
+            return entry.first == std::this_thread::get_id();
+        });
+
+        auto found = idle == idleConnections.rend() ? idleConnections.end() - 1 : std::next(idle).base();
+        auto connection = std::move(found->second);
+        idleConnections.erase(found);
+
+        return connection;
+    }
+
+    void returnConnection(std::unique_ptr<Connection> connection)
+    {
+        std::lock_guard lock(poolMutex);
+
+        // Close the connection idle for the longest time
+        if (idleConnections.size() == MAX_IDLE_CONNECTIONS)
+        {
+            idleConnections.erase(idleConnections.begin());
+        }
+
+        idleConnections.emplace_back(std::this_thread::get_id(), std::move(connection));
+    }
+
+    void connect()
+    {
+        // Initialize TLS
+        sslContext.emplace(boost::asio::ssl::context::tlsv12_client);
+
+        // Load the root certificates
+        load_root_certificates(*sslContext);
+        sslContext->set_verify_mode(boost::asio::ssl::verify_peer);
+
+        // Resolve the domain name
+        boost::asio::io_context ioContext;
+        boost::asio::ip::tcp::resolver resolver(ioContext);
+
+        resolvedHost = resolver.resolve(host, protocol);
+    }
+
+    std::string host;
+    std::string protocol;
+    std::string path;
+    std::string key;
+
+    std::once_flag connected;
+    std::optional<boost::asio::ssl::context> sslContext;
+    boost::asio::ip::tcp::resolver::results_type resolvedHost;
+
+    std::mutex poolMutex;
+    // Idle connections and the thread that used them last, oldest first
+    std::vector<std::pair<std::thread::id, std::unique_ptr<Connection>>> idleConnections;
+};
+
+// Extract the assistant message from the body of a chat completion response
+inline std::string extractAssistantMessage(const std::string& responseText)
+{
+    // Read the JSON response
+    auto responseJson = boost::json::parse(responseText);
+
+    // Extract the assistant message
+    auto pointer = responseJson.at_pointer("/choices/0/message/content");
+
+    return std::string(pointer.get_string());
+}
+
+// Tokens counted by OpenAI for a request
+struct TokenUsage
+{
+    std::int64_t promptTokens = 0;
+    std::int64_t completionTokens = 0;
+};
+
+// The parts of a chat completion response reported to batch users
+struct ChatCompletion
+{
+    std::string content;
+    std::string finishReason;
+    std::optional<TokenUsage> usage;
+};
+
+// Extract the assistant message, the reason the generation stopped and the token usage from a chat completion response
+inline ChatCompletion extractChatCompletion(const std::string& responseText)
+{
+    auto responseJson = boost::json::parse(responseText);
+
+    ChatCompletion completion;
+    completion.content = std::string(responseJson.at_pointer("/choices/0/message/content").get_string());
+
+    boost::system::error_code error;
+
+    if (auto finishReason = responseJson.find_pointer("/choices/0/finish_reason", error); finishReason != nullptr && finishReason->is_string())
+    {
+        completion.finishReason = std::string(finishReason->get_string());
+    }
+
+    if (auto usage = responseJson.find_pointer("/usage", error); usage != nullptr && usage->is_object())
+    {
+        auto count = [&](std::string_view name) {
+            auto tokens = usage->as_object().if_contains(name);
+
+            return tokens != nullptr && tokens->is_number() ? tokens->to_number<std::int64_t>() : 0;
+        };
+
+        completion.usage = TokenUsage { count("prompt_tokens"), count("completion_tokens") };
+    }
+
+    return completion;
+}
+
+// Create the body of an embeddings request for `input`
+inline std::string makeEmbeddingRequestBody(std::string_view input)
+{
+    std::string body = "{\"input\":";
+    appendJsonString(body, input);
+    body += '}';
+
+    return body;
+}
+
+// Extract the embedding vector from the body of an embeddings response
+inline std::vector<float> extractEmbedding(const std::string& responseText)
+{
+    auto responseJson = boost::json::parse(responseText);
+    const auto& values = responseJson.at_pointer("/data/0/embedding").as_array();
+
+    std::vector<float> embedding;
+    embedding.reserve(values.size());
+
+    for (const auto& value : values)
+    {
+        embedding.push_back(value.to_number<float>());
+    }
+
+    return embedding;
+}
+
+#endif //MAGNUS_LIBER_OPENAI_HPP
@@ -0,0 +1,576 @@
+#ifndef MAGNUS_LIBER_PERSISTENT_CACHE_HPP
+#define MAGNUS_LIBER_PERSISTENT_CACHE_HPP
+
+#include "response_cache.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Answers to previous requests, kept on disk and shared by every run of the program.
+//
+// The cache is made of two memory-mapped files in the cache directory:
+//
+//   responses.log    Append-only records: [magic][answer length: uint32][response size: uint64][key: 32 bytes][answer]
+//   responses.index  An open-addressing hash table of slots: [log offset: uint64][key tag: uint64][record size: uint64]
+//
+// Lookups take no lock: a slot is published by writing its log offset last, and the key stored in the log
+// record is always compared, so a reader never returns another request's answer. Writers from any process
+// serialise on an advisory lock on `responses.lock`.
+//
+// Compaction writes new files and renames them over the old ones. Processes that still map the old files keep
+// reading them safely and switch to the new ones at their next lookup.
+//
+// The persistent cache uses POSIX file locking and mapping. On Windows it is disabled and only the in-process
+// cache is used.
+class PersistentResponseCache
+{
+public:
+    explicit PersistentResponseCache(std::filesystem::path directory, std::size_t capacity)
+        : directory(std::move(directory)), capacity(capacity)
+    {
+#ifndef _WIN32
+        std::filesystem::create_directories(this->directory);
+
+        lockFile = ::open(lockPath().c_str(), O_RDWR | O_CREAT, 0644);
+
+        if (lockFile < 0)
+        {
+            throw std::runtime_error("Failed to open " + lockPath());
+        }
+
+        try
+        {
+            {
+                FileLock lock(lockFile);
+
+                if (!std::filesystem::exists(indexPath()))
+                {
+                    createFiles(indexPath(), logPath(), INITIAL_SLOT_COUNT, {});
+                }
+            }
+
+            open();
+        }
+        catch (...)
+        {
+            // The destructor does not run for a cache that failed to open
+            close();
+            ::close(lockFile);
+            throw;
+        }
+
+        // Compact in the background when the table is getting full or the log has outgrown its capacity
+        if (needsCompaction())
+        {
+            compactor = std::thread([this]() {
+                // The cache keeps working uncompacted; the next process to open it tries again
+                try
+                {
+                    compact();
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Warning: The response cache could not be compacted: " << e.what() << std::endl;
+                }
+            });
+        }
+#endif
+    }
+
+    PersistentResponseCache(const PersistentResponseCache&) = delete;
+    PersistentResponseCache& operator=(const PersistentResponseCache&) = delete;
+
+    ~PersistentResponseCache()
+    {
+#ifndef _WIN32
+        if (compactor.joinable())
+        {
+            compactor.join();
+        }
+
+        close();
+        ::close(lockFile);
+#endif
+    }
+
+    // Return the answer cached under `key`
+    std::optional<std::string> find(const CacheKey& key)
+    {
+#ifndef _WIN32
+        std::lock_guard guard(mutex);
+
+        reopenIfReplaced();
+
+        if (auto record = findRecord(key))
+        {
+            ++hits;
+
+            return std::string(logData + record + RECORD_HEADER_SIZE, recordAnswerLength(record));
+        }
+#endif
+
+        return std::nullopt;
+    }
+
+    // Cache `answer` under `key`. `responseSize` is the size of the response it came from.
+    void insert(const CacheKey& key, const std::string& answer, std::size_t responseSize)
+    {
+#ifndef _WIN32
+        std::lock_guard guard(mutex);
+        FileLock lock(lockFile);
+
+        // Another process may have compacted or added the same answer since the last lookup
+        reopenIfReplaced();
+
+        if (findRecord(key) != 0 || loadFactor() > MAX_LOAD_FACTOR)
+        {
+            return;
+        }
+
+        // Append the record to the log...
+        auto record = makeRecord(key, answer, responseSize);
+
+        struct stat logStat {};
+        ::fstat(logFile, &logStat);
+
+        auto offset = static_cast<std::uint64_t>(logStat.st_size);
+
+        if (::pwrite(logFile, record.data(), record.size(), static_cast<off_t>(offset)) != static_cast<ssize_t>(record.size()))
+        {
+            return;
+        }
+
+        // ...then publish it in the index. The offset goes last: it is what readers look for.
+        auto slot = findSlot(key);
+
+        slot->tag = keyTag(key);
+        slot->size = record.size();
+        std::atomic_ref(slot->offset).store(offset, std::memory_order_release);
+        std::atomic_ref(indexHeader()->entryCount).fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    // Number of questions answered from the persistent cache
+    std::size_t hitCount() const
+    {
+        return hits;
+    }
+
+private:
+    static constexpr char INDEX_MAGIC[8] = { 'M', 'L', 'I', 'N', 'D', 'E', 'X', '1' };
+    static constexpr char LOG_MAGIC[8] = { 'M', 'L', 'R', 'L', 'O', 'G', '0', '1' };
+    static constexpr std::uint32_t RECORD_MAGIC = 0x4d4c5245;
+    static constexpr std::size_t RECORD_HEADER_SIZE = sizeof(std::uint32_t) + sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(CacheKey);
+    static constexpr std::uint64_t INITIAL_SLOT_COUNT = 4096;
+    static constexpr double MAX_LOAD_FACTOR = 0.7;
+    static constexpr double COMPACTION_LOAD_FACTOR = 0.5;
+
+    struct IndexHeader
+    {
+        char magic[8];
+        std::uint64_t slotCount;
+        std::uint64_t entryCount;
+        std::uint64_t reserved[5];
+    };
+
+    struct Slot
+    {
+        std::uint64_t offset;   // 0 if the slot is empty
+        std::uint64_t tag;
+        std::uint64_t size;
+    };
+
+    // An advisory lock held for the lifetime of the object
+    struct FileLock
+    {
+        explicit FileLock(int file)
+            : file(file)
+        {
+#ifndef _WIN32
+            ::flock(file, LOCK_EX);
+#endif
+        }
+
+        ~FileLock()
+        {
+#ifndef _WIN32
+            ::flock(file, LOCK_UN);
+#endif
+        }
+
+        int file;
+    };
+
+    std::string indexPath() const
+    {
+        return (directory / "responses.index").string();
+    }
+
+    std::string logPath() const
+    {
+        return (directory / "responses.log").string();
+    }
+
+    std::string lockPath() const
+    {
+        return (directory / "responses.lock").string();
+    }
+
+    static std::uint64_t keyTag(const CacheKey& key)
+    {
+        std::uint64_t tag;
+        std::memcpy(&tag, key.data() + sizeof(tag), sizeof(tag));
+
+        return tag;
+    }
+
+    static std::string makeRecord(const CacheKey& key, std::string_view answer, std::uint64_t responseSize)
+    {
+        auto answerLength = static_cast<std::uint32_t>(answer.size());
+        std::string record;
+
+        record.append(reinterpret_cast<const char*>(&RECORD_MAGIC), sizeof(RECORD_MAGIC));
+        record.append(reinterpret_cast<const char*>(&answerLength), sizeof(answerLength));
+        record.append(reinterpret_cast<const char*>(&responseSize), sizeof(responseSize));
+        record.append(reinterpret_cast<const char*>(key.data()), key.size());
+        record.append(answer);
+
+        return record;
+    }
+
+#ifndef _WIN32
+    IndexHeader* indexHeader() const
+    {
+        return reinterpret_cast<IndexHeader*>(indexData);
+    }
+
+    Slot* slots() const
+    {
+        return reinterpret_cast<Slot*>(indexData + sizeof(IndexHeader));
+    }
+
+    double loadFactor() const
+    {
+        return static_cast<double>(indexHeader()->entryCount) / static_cast<double>(indexHeader()->slotCount);
+    }
+
+    bool needsCompaction() const
+    {
+        return loadFactor() > COMPACTION_LOAD_FACTOR || logSize > capacity;
+    }
+
+    std::uint32_t recordAnswerLength(std::uint64_t record) const
+    {
+        std::uint32_t length;
+        std::memcpy(&length, logData + record + sizeof(RECORD_MAGIC), sizeof(length));
+
+        return length;
+    }
+
+    // The slot holding `key`, or the empty slot where it belongs
+    Slot* findSlot(const CacheKey& key)
+    {
+        auto mask = indexHeader()->slotCount - 1;
+        auto position = CacheKeyHash()(key) & mask;
+
+        for (std::uint64_t probe = 0; probe <= mask; ++probe)
+        {
+            auto slot = &slots()[(position + probe) & mask];
+            auto offset = std::atomic_ref(slot->offset).load(std::memory_order_acquire);
+
+            if (offset == 0 || (slot->tag == keyTag(key) && recordMatches(offset, slot->size, key)))
+            {
+                return slot;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // The log offset of the record of `key`, or 0
+    std::uint64_t findRecord(const CacheKey& key)
+    {
+        auto slot = findSlot(key);
+
+        if (slot == nullptr)
+        {
+            return 0;
+        }
+
+        return std::atomic_ref(slot->offset).load(std::memory_order_acquire);
+    }
+
+    bool recordMatches(std::uint64_t offset, std::uint64_t size, const CacheKey& key)
+    {
+        // The record may have been appended by another process after the log was mapped
+        if (offset + size > logSize && !remapLog(offset + size))
+        {
+            return false;
+        }
+
+        std::uint32_t magic;
+        std::memcpy(&magic, logData + offset, sizeof(magic));
+
+        return magic == RECORD_MAGIC && std::memcmp(logData + offset + RECORD_HEADER_SIZE - sizeof(CacheKey), key.data(), key.size()) == 0;
+    }
+
+    bool remapLog(std::uint64_t minimumSize)
+    {
+        struct stat logStat {};
+        ::fstat(logFile, &logStat);
+
+        if (static_cast<std::uint64_t>(logStat.st_size) < minimumSize)
+        {
+            return false;
+        }
+
+        if (logData != nullptr)
+        {
+            ::munmap(logData, logSize);
+        }
+
+        logSize = static_cast<std::size_t>(logStat.st_size);
+        logData = static_cast<char*>(::mmap(nullptr, logSize, PROT_READ, MAP_SHARED, logFile, 0));
+
+        if (logData == MAP_FAILED)
+        {
+            logData = nullptr;
+            logSize = 0;
+
+            return false;
+        }
+
+        return true;
+    }
+
+    void open()
+    {
+        indexFile = ::open(indexPath().c_str(), O_RDWR);
+        logFile = ::open(logPath().c_str(), O_RDWR);
+
+        struct stat indexStat {};
+        ::fstat(indexFile, &indexStat);
+
+        indexSize = static_cast<std::size_t>(indexStat.st_size);
+        indexInode = indexStat.st_ino;
+        indexData = static_cast<char*>(::mmap(nullptr, indexSize, PROT_READ | PROT_WRITE, MAP_SHARED, indexFile, 0));
+
+        if (indexData == MAP_FAILED || indexSize < sizeof(IndexHeader) || std::memcmp(indexHeader()->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        {
+            throw std::runtime_error(indexPath() + " is not a response cache index");
+        }
+
+        remapLog(0);
+    }
+
+    void close()
+    {
+        if (indexData != nullptr && indexData != MAP_FAILED)
+        {
+            ::munmap(indexData, indexSize);
+        }
+
+        if (logData != nullptr)
+        {
+            ::munmap(logData, logSize);
+        }
+
+        ::close(indexFile);
+        ::close(logFile);
+
+        indexData = nullptr;
+        logData = nullptr;
+        logSize = 0;
+    }
+
+    // Switch to the new files if the cache was compacted since they were opened
+    void reopenIfReplaced()
+    {
+        struct stat indexStat {};
+
+        if (::stat(indexPath().c_str(), &indexStat) == 0 && indexStat.st_ino != indexInode)
+        {
+            close();
+            open();
+        }
+    }
+
+    // Write a new index and log holding `records`, then rename them to `index` and `log`
+    static void createFiles(const std::string& index, const std::string& log, std::uint64_t slotCount, const std::vector<std::pair<CacheKey, std::string>>& records)
+    {
+        auto temporaryIndex = index + ".tmp";
+        auto temporaryLog = log + ".tmp";
+
+        std::vector<Slot> table(slotCount, Slot {});
+        std::string logText(LOG_MAGIC, sizeof(LOG_MAGIC));
+
+        for (const auto& [key, record] : records)
+        {
+            auto position = CacheKeyHash()(key) & (slotCount - 1);
+
+            while (table[position].offset != 0)
+            {
+                position = (position + 1) & (slotCount - 1);
+            }
+
+            table[position] = { logText.size(), keyTag(key), record.size() };
+            logText += record;
+        }
+
+        IndexHeader header {};
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.slotCount = slotCount;
+        header.entryCount = records.size();
+
+        auto write = [](const std::string& path, const void* data, std::size_t size, const void* more, std::size_t moreSize) {
+            auto file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            auto written = ::write(file, data, size) + (moreSize > 0 ? ::write(file, more, moreSize) : 0);
+
+            ::fsync(file);
+            ::close(file);
+
+            return written == static_cast<ssize_t>(size + moreSize);
+        };
+
+        if (!write(temporaryLog, logText.data(), logText.size(), nullptr, 0) ||
+            !write(temporaryIndex, &header, sizeof(header), table.data(), table.size() * sizeof(Slot)))
+        {
+            throw std::runtime_error("Failed to write the response cache in " + index);
+        }
+
+        // The log goes first: processes look for a new index, then open the log that goes with it
+        std::filesystem::rename(temporaryLog, log);
+        std::filesystem::rename(temporaryIndex, index);
+    }
+
+    // Rebuild the cache under the lock of the cache directory
+    void compact()
+    {
+        // Locks belong to open files: the lock must be taken through a file of its own to keep out this process too
+        auto compactionLockFile = ::open(lockPath().c_str(), O_RDWR);
+
+        if (compactionLockFile < 0)
+        {
+            throw std::runtime_error("Failed to open " + lockPath());
+        }
+
+        try
+        {
+            FileLock lock(compactionLockFile);
+            rebuild();
+        }
+        catch (...)
+        {
+            ::close(compactionLockFile);
+            throw;
+        }
+
+        ::close(compactionLockFile);
+    }
+
+    // Rebuild the cache with a larger table, keeping the most recent records within half of the capacity
+    void rebuild()
+    {
+        // Work on files of our own: the maps of this object belong to the thread answering questions
+        auto file = ::open(logPath().c_str(), O_RDONLY);
+
+        if (file < 0)
+        {
+            throw std::runtime_error("Failed to open " + logPath());
+        }
+
+        struct stat logStat {};
+        ::fstat(file, &logStat);
+
+        std::string logText(static_cast<std::size_t>(logStat.st_size), '\0');
+        auto read = ::pread(file, logText.data(), logText.size(), 0);
+        ::close(file);
+
+        if (read != static_cast<ssize_t>(logText.size()))
+        {
+            return;
+        }
+
+        std::vector<std::pair<CacheKey, std::string>> records;
+
+        for (std::size_t offset = sizeof(LOG_MAGIC); offset + RECORD_HEADER_SIZE <= logText.size();)
+        {
+            std::uint32_t magic;
+            std::uint32_t answerLength;
+            std::memcpy(&magic, logText.data() + offset, sizeof(magic));
+            std::memcpy(&answerLength, logText.data() + offset + sizeof(magic), sizeof(answerLength));
+
+            auto size = RECORD_HEADER_SIZE + answerLength;
+
+            if (magic != RECORD_MAGIC || offset + size > logText.size())
+            {
+                break;
+            }
+
+            CacheKey key;
+            std::memcpy(key.data(), logText.data() + offset + RECORD_HEADER_SIZE - key.size(), key.size());
+            records.emplace_back(key, logText.substr(offset, size));
+
+            offset += size;
+        }
+
+        // Drop the oldest records
+        std::size_t keptSize = 0;
+        auto kept = records.end();
+
+        while (kept != records.begin() && keptSize + std::prev(kept)->second.size() <= capacity / 2)
+        {
+            --kept;
+            keptSize += kept->second.size();
+        }
+
+        records.erase(records.begin(), kept);
+
+        auto slotCount = INITIAL_SLOT_COUNT;
+
+        while (static_cast<double>(records.size()) > static_cast<double>(slotCount) * COMPACTION_LOAD_FACTOR / 2)
+        {
+            slotCount *= 2;
+        }
+
+        createFiles(indexPath(), logPath(), slotCount, records);
+    }
+
+    char* indexData = nullptr;
+    std::size_t indexSize = 0;
+    ino_t indexInode = 0;
+    char* logData = nullptr;
+    std::size_t logSize = 0;
+
+    int indexFile = -1;
+    int logFile = -1;
+    int lockFile = -1;
+#endif
+
+    std::filesystem::path directory;
+    std::size_t capacity;
+    std::size_t hits = 0;
+
+    // Serialises the threads of this process. Other processes are kept out by `responses.lock`.
+    std::mutex mutex;
+    std::thread compactor;
+};
+
+#endif //MAGNUS_LIBER_PERSISTENT_CACHE_HPP
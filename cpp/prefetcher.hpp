@@ -0,0 +1,175 @@
+#ifndef MAGNUS_LIBER_PREFETCHER_HPP
+#define MAGNUS_LIBER_PREFETCHER_HPP
+
+#include "emperor_index.hpp"
+#include "history_selector.hpp"
+#include "reign_timeline.hpp"
+#include "response_cache.hpp"
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// A follow-up question asked ahead of the user
+struct PrefetchRequest
+{
+    CacheKey key;
+    std::string question;
+    std::string body;
+};
+
+struct PrefetchResult
+{
+    CacheKey key;
+    std::string question;
+    std::string answer;
+    std::size_t responseSize;
+
+    // Estimated tokens of the prompt and the answer
+    std::size_t tokens;
+};
+
+// Follow-up questions the user is likely to ask after `answer`: when it describes a single emperor, who came
+// before and after them. Neighbours the timeline already knows are skipped, since they are answered locally.
+inline std::vector<std::string> likelyFollowUps(std::string_view answer, const ReignTimeline& reignTimeline)
+{
+    auto records = parseEmperorAnswer(answer);
+
+    if (records.size() != 1)
+    {
+        return {};
+    }
+
+    const auto& record = records.front();
+    std::vector<std::string> questions;
+
+    if (!reignTimeline.hasPredecessor(record))
+    {
+        questions.push_back("Who preceded " + record.name + "?");
+    }
+
+    if (!reignTimeline.hasSuccessor(record))
+    {
+        questions.push_back("Who succeeded " + record.name + "?");
+    }
+
+    return questions;
+}
+
+// Asks likely follow-up questions on a background thread while the user reads the answer.
+//
+// Requests are sent one after another, never alongside each other, so they stay behind the user's own
+// requests. Each is only sent if the rest of the token budget covers its prompt and the longest possible
+// answer; once answered it is charged for its actual size.
+// Like the history summary, results are handed back to the main thread at the start of the next turn.
+class Prefetcher
+{
+public:
+    Prefetcher(std::size_t tokenBudget, std::size_t maxAnswerTokens)
+        : budget(tokenBudget), maxAnswerTokens(maxAnswerTokens)
+    {
+    }
+
+    // Send `requests` in the background with `send`, which takes a request and returns the response body.
+    // Does nothing if the previous requests are still in flight.
+    template<typename Send>
+    void start(std::vector<PrefetchRequest> requests, Send send)
+    {
+        if (pending())
+        {
+            return;
+        }
+
+        // Reserve the worst case now so the budget is never exceeded
+        std::vector<PrefetchRequest> affordable;
+
+        for (auto& request : requests)
+        {
+            auto cost = estimateTokens(request.body) + maxAnswerTokens;
+
+            if (spent + reserved + cost <= budget)
+            {
+                reserved += cost;
+                affordable.push_back(std::move(request));
+            }
+        }
+
+        if (affordable.empty())
+        {
+            return;
+        }
+
+        results = std::async(std::launch::async, [requests = std::move(affordable), send]() {
+            std::vector<PrefetchResult> answers;
+
+            for (const auto& request : requests)
+            {
+                try
+                {
+                    auto responseText = send(request);
+                    auto answer = extractAssistantMessage(responseText);
+                    auto tokens = estimateTokens(request.body) + estimateTokens(answer);
+
+                    answers.push_back({ request.key, request.question, std::move(answer), responseText.size(), tokens });
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Warning: Failed to prefetch \"" << request.question << "\": " << e.what() << std::endl;
+                }
+            }
+
+            return answers;
+        });
+    }
+
+    // True while requests are in flight
+    bool pending() const
+    {
+        return results.valid();
+    }
+
+    // Return the answers received if every request has completed, and charge them to the budget
+    std::vector<PrefetchResult> collect()
+    {
+        if (!pending() || results.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return {};
+        }
+
+        auto answers = results.get();
+
+        for (const auto& answer : answers)
+        {
+            spent += answer.tokens;
+        }
+
+        fetched += answers.size();
+        reserved = 0;
+
+        return answers;
+    }
+
+    std::size_t fetchedCount() const
+    {
+        return fetched;
+    }
+
+    std::size_t spentTokens() const
+    {
+        return spent;
+    }
+
+private:
+    std::future<std::vector<PrefetchResult>> results;
+
+    std::size_t budget;
+    std::size_t maxAnswerTokens;
+    std::size_t spent = 0;
+    std::size_t reserved = 0;
+    std::size_t fetched = 0;
+};
+
+#endif //MAGNUS_LIBER_PREFETCHER_HPP
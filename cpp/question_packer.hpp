@@ -0,0 +1,244 @@
+#ifndef MAGNUS_LIBER_QUESTION_PACKER_HPP
+#define MAGNUS_LIBER_QUESTION_PACKER_HPP
+
+#include "emperor_index.hpp"
+#include "openai.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sent after the system message with packed questions. The numbers are those of the numbered form of the
+// system message, so answers are split by them.
+constexpr auto PACKING_INSTRUCTIONS = "The user asks several independent questions at once, numbered. Answer every question, in order. "
+    "Start the answer to each question on a new line with the number of the question followed by ' - ', as in the numbered form, "
+    "then give the answer in its usual form. Do not number the emperors within the answer to a question.";
+
+// How long the first question of a pack waits for others before the pack is sent as it is
+constexpr auto PACK_WAIT = std::chrono::milliseconds(50);
+
+// The text of the user message asking `questions`: "1 - <question>" on each line
+inline std::string packQuestions(std::span<const std::string_view> questions)
+{
+    std::string text;
+
+    for (std::size_t i = 0; i < questions.size(); ++i)
+    {
+        text += std::to_string(i + 1) + " - ";
+        text += questions[i];
+        text += '\n';
+    }
+
+    return text;
+}
+
+// Split the answer to `count` packed questions by the numbers starting its lines. Every question must have one
+// non-empty answer, started by its number, in order. Otherwise, as when an answer holds a numbered list of its own,
+// the answers cannot be told apart, and nothing is returned so that every question is asked again on its own.
+inline std::optional<std::vector<std::string>> unpackAnswers(std::string_view response, std::size_t count)
+{
+    std::vector<std::string> answers;
+    std::string text;
+
+    // Trim the answer being read. Text before the first number is only allowed to be blank.
+    auto finish = [&]() {
+        auto answer = std::string(trim(text));
+        text.clear();
+
+        if (answers.empty())
+        {
+            return answer.empty();
+        }
+
+        answers.back() = std::move(answer);
+
+        return !answers.back().empty();
+    };
+
+    for (std::size_t start = 0; start < response.size();)
+    {
+        auto end = std::min(response.find('\n', start), response.size());
+        auto line = response.substr(start, end - start);
+        start = end + 1;
+
+        // "<number> - " starts the answer to the next question
+        auto digits = std::min(line.find_first_not_of("0123456789"), line.size());
+
+        if (digits > 0 && line.substr(digits).starts_with(" - "))
+        {
+            if (line.substr(0, digits) != std::to_string(answers.size() + 1) || answers.size() == count || !finish())
+            {
+                return std::nullopt;
+            }
+
+            answers.emplace_back();
+            line.remove_prefix(digits + 3);
+        }
+
+        text += line;
+        text += '\n';
+    }
+
+    if (answers.size() != count || !finish())
+    {
+        return std::nullopt;
+    }
+
+    return answers;
+}
+
+// The answer to one of the questions of a pack
+struct PackedAnswer
+{
+    std::string text;
+    std::string finishReason;
+
+    // The usage of the pack, shared evenly between its questions
+    TokenUsage usage;
+};
+
+// Groups independent questions asked at the same time into a single request of up to `packSize` questions, so
+// the system message and the overhead of a request are paid once for all of them.
+//
+// The first question of a pack waits up to PACK_WAIT for others, and the pack is sent by the thread that fills
+// it or by the first one once the wait is over. Every thread then gets the answer to its own question.
+class QuestionPacker
+{
+public:
+    explicit QuestionPacker(std::size_t packSize)
+        : packSize(std::max<std::size_t>(packSize, 1))
+    {
+    }
+
+    // Return the answer to `question` from a pack sent with `send`, which takes the text of the packed questions
+    // and returns the completion. Returns nothing if the answer was missing from the response.
+    template<typename Send>
+    std::optional<PackedAnswer> ask(std::string_view question, Send send)
+    {
+        std::unique_lock lock(mutex);
+
+        if (!open)
+        {
+            open = std::make_shared<Pack>();
+        }
+
+        auto pack = open;
+        auto first = pack->questions.empty();
+
+        pack->questions.push_back(question);
+        auto answer = pack->answers.emplace_back().get_future();
+
+        if (pack->questions.size() == packSize)
+        {
+            open.reset();
+            lock.unlock();
+            filled.notify_all();
+
+            dispatch(*pack, send);
+        }
+        else if (first)
+        {
+            filled.wait_for(lock, PACK_WAIT, [&]() { return open != pack; });
+
+            if (open == pack)
+            {
+                open.reset();
+                lock.unlock();
+
+                dispatch(*pack, send);
+            }
+        }
+
+        if (lock.owns_lock())
+        {
+            lock.unlock();
+        }
+
+        return answer.get();
+    }
+
+    // Number of requests sent, of questions they asked, and of questions they answered
+    std::size_t packCount() const
+    {
+        return packs;
+    }
+
+    std::size_t packedCount() const
+    {
+        return packed;
+    }
+
+    std::size_t answeredCount() const
+    {
+        return answered;
+    }
+
+private:
+    struct Pack
+    {
+        std::vector<std::string_view> questions;
+        std::vector<std::promise<std::optional<PackedAnswer>>> answers;
+    };
+
+    template<typename Send>
+    void dispatch(Pack& pack, Send send)
+    {
+        try
+        {
+            ChatCompletion completion = send(packQuestions(pack.questions));
+            auto texts = unpackAnswers(completion.content, pack.questions.size());
+
+            TokenUsage share;
+
+            if (completion.usage)
+            {
+                share.promptTokens = completion.usage->promptTokens / static_cast<std::int64_t>(pack.questions.size());
+                share.completionTokens = completion.usage->completionTokens / static_cast<std::int64_t>(pack.questions.size());
+            }
+
+            ++packs;
+            packed += pack.questions.size();
+
+            for (std::size_t i = 0; i < pack.questions.size(); ++i)
+            {
+                if (texts)
+                {
+                    ++answered;
+                    pack.answers[i].set_value(PackedAnswer { std::move((*texts)[i]), completion.finishReason, share });
+                }
+                else
+                {
+                    pack.answers[i].set_value(std::nullopt);
+                }
+            }
+        }
+        catch (...)
+        {
+            for (auto& answer : pack.answers)
+            {
+                answer.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    std::size_t packSize;
+
+    std::mutex mutex;
+    std::condition_variable filled;
+    std::shared_ptr<Pack> open;
+
+    std::atomic<std::size_t> packs = 0;
+    std::atomic<std::size_t> packed = 0;
+    std::atomic<std::size_t> answered = 0;
+};
+
+#endif //MAGNUS_LIBER_QUESTION_PACKER_HPP
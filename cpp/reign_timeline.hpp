@@ -0,0 +1,313 @@
+#ifndef MAGNUS_LIBER_REIGN_TIMELINE_HPP
+#define MAGNUS_LIBER_REIGN_TIMELINE_HPP
+
+#include "emperor_index.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Years from `first` to `last` included, negative before Christ
+struct YearRange
+{
+    int first;
+    int last;
+};
+
+// The phrases a year question is made of, in order: "Which emperors / ruled / the empire / in / 395 AD / ?".
+// Questions phrased otherwise ("How many emperors were killed in 70 AD?") are left to OpenAI.
+constexpr std::string_view SUBJECT_PHRASES[] = { "who", "which emperor", "which emperors", "what emperor", "what emperors" };
+constexpr std::string_view RULE_PHRASES[] = {
+    "ruled", "reigned", "was emperor", "were emperors", "was the emperor", "were the emperors", "was ruler", "was the ruler",
+    "was ruling", "were ruling", "was reigning", "were reigning", "was on the throne", "were on the throne", "held the throne",
+};
+constexpr std::string_view PLACE_PHRASES[] = { "rome", "of rome", "over rome", "the empire", "the roman empire", "of the roman empire" };
+constexpr std::string_view YEAR_WORDS[] = { "around", "between", "during", "from", "in" };
+constexpr std::string_view PERIOD_END_WORDS[] = { "and", "through", "till", "to", "until" };
+
+// Return the years `question` asks about if it asks who ruled then: "Who ruled in 395 AD?",
+// "Who was emperor in AD 68?", "Who reigned between 235 and 284?", "Which emperors ruled from 49 to 44 BC?"
+inline std::optional<YearRange> parseYearQuestion(std::string_view question)
+{
+    std::vector<std::string> words;
+    auto text = normaliseName(question);
+
+    for (std::size_t start = 0; start < text.size();)
+    {
+        auto end = std::min(text.find(' ', start), text.size());
+        words.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+
+    std::size_t i = 0;
+
+    // Skip the longest of `phrases` starting at `i`. Returns false if none does.
+    auto readPhrase = [&](const auto& phrases) {
+        std::size_t longest = 0;
+
+        for (auto phrase : phrases)
+        {
+            for (std::size_t start = 0, position = i; position < words.size(); ++position)
+            {
+                auto end = std::min(phrase.find(' ', start), phrase.size());
+
+                if (phrase.substr(start, end - start) != words[position])
+                {
+                    break;
+                }
+
+                if (end == phrase.size())
+                {
+                    longest = std::max(longest, position + 1 - i);
+                    break;
+                }
+
+                start = end + 1;
+            }
+        }
+
+        i += longest;
+
+        return longest > 0;
+    };
+
+    // Read a year at `i`, written "395", "395 ad", "ad 395" or "44 bc". Sets `beforeChrist` if it is followed by BC.
+    auto readYear = [&](bool& beforeChrist) -> std::optional<int> {
+        if (i < words.size() && (words[i] == "ad" || words[i] == "ce"))
+        {
+            ++i;
+        }
+
+        int year = 0;
+        const auto* first = i < words.size() ? words[i].data() : nullptr;
+        const auto* last = i < words.size() ? first + words[i].size() : nullptr;
+
+        if (i >= words.size() || words[i].size() > 4 || std::from_chars(first, last, year).ptr != last)
+        {
+            return std::nullopt;
+        }
+
+        ++i;
+        beforeChrist = i < words.size() && (words[i] == "bc" || words[i] == "bce");
+
+        if (i < words.size() && (beforeChrist || words[i] == "ad" || words[i] == "ce"))
+        {
+            ++i;
+        }
+
+        return year;
+    };
+
+    if (!readPhrase(SUBJECT_PHRASES) || !readPhrase(RULE_PHRASES))
+    {
+        return std::nullopt;
+    }
+
+    readPhrase(PLACE_PHRASES);
+
+    auto firstBeforeChrist = false;
+    auto first = readPhrase(YEAR_WORDS) ? readYear(firstBeforeChrist) : std::nullopt;
+
+    if (!first)
+    {
+        return std::nullopt;
+    }
+
+    auto last = first;
+    auto lastBeforeChrist = firstBeforeChrist;
+
+    if (readPhrase(PERIOD_END_WORDS))
+    {
+        last = readYear(lastBeforeChrist);
+
+        if (!last)
+        {
+            return std::nullopt;
+        }
+
+        // "From 49 to 44 BC": the era written after the period applies to both years
+        firstBeforeChrist = firstBeforeChrist || (lastBeforeChrist && *first >= *last);
+    }
+
+    // Anything after the year changes the question: "Which emperors ruled in 2 empires?"
+    if (i != words.size())
+    {
+        return std::nullopt;
+    }
+
+    YearRange range { firstBeforeChrist ? -*first : *first, lastBeforeChrist ? -*last : *last };
+
+    if (range.first > range.last)
+    {
+        std::swap(range.first, range.last);
+    }
+
+    return range;
+}
+
+// The reigns of the emperors of an EmperorIndex, to find who ruled in a given year.
+//
+// The reigns barely change, so rather than a dynamic interval tree they are kept sorted by start, with the
+// latest end of any reign up to each position. The reigns overlapping a range are then found with two binary
+// searches and a scan of the reigns that started in between.
+class ReignTimeline
+{
+public:
+    explicit ReignTimeline(const EmperorIndex& emperorIndex)
+        : emperorIndex(emperorIndex)
+    {
+        rebuild();
+    }
+
+    // Rebuild the timeline after emperors were added to the index
+    void rebuild()
+    {
+        reigns.clear();
+
+        const auto& records = emperorIndex.allRecords();
+
+        for (std::size_t i = 0; i < records.size(); ++i)
+        {
+            if (records[i].startYear && records[i].endYear && *records[i].startYear <= *records[i].endYear)
+            {
+                reigns.push_back({ *records[i].startYear, *records[i].endYear, static_cast<std::uint32_t>(i) });
+            }
+        }
+
+        std::sort(reigns.begin(), reigns.end(), [](const Reign& a, const Reign& b) { return a.start < b.start; });
+
+        latestEnds.resize(reigns.size());
+
+        for (std::size_t i = 0; i < reigns.size(); ++i)
+        {
+            latestEnds[i] = i == 0 ? reigns[i].end : std::max(latestEnds[i - 1], reigns[i].end);
+        }
+    }
+
+    // Answer `question` if it asks who ruled in a year or period and the known reigns cover every year of it.
+    // Otherwise the index may be missing an emperor, and the question is left to OpenAI.
+    std::optional<std::string> answer(std::string_view question) const
+    {
+        auto range = parseYearQuestion(question);
+
+        if (!range)
+        {
+            return std::nullopt;
+        }
+
+        auto overlapping = find(*range);
+
+        // Check that the reigns leave no year of the range without an emperor
+        auto covered = range->first - 1;
+
+        for (const auto* reign : overlapping)
+        {
+            if (reign->start > covered + 1)
+            {
+                return std::nullopt;
+            }
+
+            covered = std::max(covered, reign->end);
+        }
+
+        if (covered < range->last)
+        {
+            return std::nullopt;
+        }
+
+        // Answer in the format of the system message, numbered if there are several emperors
+        const auto& records = emperorIndex.allRecords();
+        std::string text;
+
+        for (std::size_t i = 0; i < overlapping.size(); ++i)
+        {
+            if (overlapping.size() > 1)
+            {
+                text += (i == 0 ? "" : "\n\n") + std::to_string(i + 1) + " - ";
+            }
+
+            text += formatEmperorRecord(records[overlapping[i]->record]);
+        }
+
+        return text;
+    }
+
+    // True if the timeline knows who ruled just before `record`
+    bool hasPredecessor(const EmperorRecord& record) const
+    {
+        if (!record.startYear)
+        {
+            return false;
+        }
+
+        return hasNeighbour(record, *record.startYear, [&](const Reign& reign) { return reign.start < *record.startYear; });
+    }
+
+    // True if the timeline knows who ruled just after `record`
+    bool hasSuccessor(const EmperorRecord& record) const
+    {
+        if (!record.endYear)
+        {
+            return false;
+        }
+
+        return hasNeighbour(record, *record.endYear, [&](const Reign& reign) { return reign.end > *record.endYear; });
+    }
+
+private:
+    struct Reign
+    {
+        int start;
+        int end;
+        std::uint32_t record;
+    };
+
+    // True if another emperor than `record` ruled within a year of `year` and matches `isNeighbour`
+    template<typename IsNeighbour>
+    bool hasNeighbour(const EmperorRecord& record, int year, IsNeighbour isNeighbour) const
+    {
+        const auto& records = emperorIndex.allRecords();
+
+        for (const auto* reign : find({ year - 1, year + 1 }))
+        {
+            if (records[reign->record].name != record.name && isNeighbour(*reign))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Reigns overlapping `range`, by start
+    std::vector<const Reign*> find(YearRange range) const
+    {
+        // Reigns before `first` ended before the range, reigns from `last` on start after it
+        auto first = std::lower_bound(latestEnds.begin(), latestEnds.end(), range.first) - latestEnds.begin();
+        auto last = std::upper_bound(reigns.begin(), reigns.end(), range.last, [](int year, const Reign& reign) { return year < reign.start; }) - reigns.begin();
+
+        std::vector<const Reign*> overlapping;
+
+        for (auto i = first; i < last; ++i)
+        {
+            if (reigns[i].end >= range.first)
+            {
+                overlapping.push_back(&reigns[i]);
+            }
+        }
+
+        return overlapping;
+    }
+
+    const EmperorIndex& emperorIndex;
+
+    // Reigns by start, and the latest end of the reigns up to each of them
+    std::vector<Reign> reigns;
+    std::vector<int> latestEnds;
+};
+
+#endif //MAGNUS_LIBER_REIGN_TIMELINE_HPP
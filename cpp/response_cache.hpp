@@ -0,0 +1,221 @@
+#ifndef MAGNUS_LIBER_RESPONSE_CACHE_HPP
+#define MAGNUS_LIBER_RESPONSE_CACHE_HPP
+
+#include "openai.hpp"
+
+#include <openssl/evp.h>
+
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// SHA-256 of a normalised request
+using CacheKey = std::array<unsigned char, 32>;
+
+struct CacheKeyHash
+{
+    std::size_t operator()(const CacheKey& key) const
+    {
+        // The key is already a strong hash: any part of it is as good as another
+        std::size_t hash;
+        std::memcpy(&hash, key.data(), sizeof(hash));
+
+        return hash;
+    }
+};
+
+// Lowercase `question` and collapse whitespace and trailing punctuation,
+// so "Who was Augustus?" and "who was  augustus" are the same question
+inline std::string normaliseQuestion(std::string_view question)
+{
+    std::string normalised;
+
+    for (auto c : question)
+    {
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            if (!normalised.empty() && normalised.back() != ' ')
+            {
+                normalised += ' ';
+            }
+        }
+        else
+        {
+            normalised += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+
+    while (!normalised.empty() && (normalised.back() == ' ' || std::ispunct(static_cast<unsigned char>(normalised.back()))))
+    {
+        normalised.pop_back();
+    }
+
+    return normalised;
+}
+
+// Computes the cache key of a request from everything that affects its answer
+class CacheKeyBuilder
+{
+public:
+    CacheKeyBuilder(std::string_view deployment, const ChatCompletionOptions& options)
+        : context(EVP_MD_CTX_new())
+    {
+        EVP_DigestInit_ex(context, EVP_sha256(), nullptr);
+
+        add(deployment);
+        add(&options.maxTokens, sizeof(options.maxTokens));
+        add(&options.temperature, sizeof(options.temperature));
+        add(&options.topP, sizeof(options.topP));
+        add(&options.presencePenalty, sizeof(options.presencePenalty));
+        add(&options.frequencyPenalty, sizeof(options.frequencyPenalty));
+    }
+
+    CacheKeyBuilder(const CacheKeyBuilder&) = delete;
+    CacheKeyBuilder& operator=(const CacheKeyBuilder&) = delete;
+
+    ~CacheKeyBuilder()
+    {
+        EVP_MD_CTX_free(context);
+    }
+
+    // Add a part of the request, such as the JSON of a message
+    void add(std::string_view part)
+    {
+        // Each part is prefixed with its length so different splits of the same bytes hash differently
+        auto size = static_cast<std::uint64_t>(part.size());
+
+        add(&size, sizeof(size));
+        add(part.data(), part.size());
+    }
+
+    CacheKey finish()
+    {
+        CacheKey key;
+        EVP_DigestFinal_ex(context, key.data(), nullptr);
+
+        return key;
+    }
+
+private:
+    void add(const void* data, std::size_t size)
+    {
+        EVP_DigestUpdate(context, data, size);
+    }
+
+    EVP_MD_CTX* context;
+};
+
+// Answers to previous requests, evicting the least recently used ones once they take more than `capacity` bytes
+class ResponseCache
+{
+public:
+    explicit ResponseCache(std::size_t capacity)
+        : capacity(capacity)
+    {
+    }
+
+    // Return the answer cached under `key`, or nullptr
+    const std::string* find(const CacheKey& key)
+    {
+        ++lookups;
+
+        auto found = index.find(key);
+
+        if (found == index.end())
+        {
+            return nullptr;
+        }
+
+        // Move the entry to the front of the list: it is now the most recently used
+        entries.splice(entries.begin(), entries, found->second);
+
+        ++hits;
+        bytesSaved += found->second->responseSize;
+
+        return &found->second->answer;
+    }
+
+    // True if an answer is cached under `key`. Unlike `find`, does not count as a lookup.
+    bool contains(const CacheKey& key) const
+    {
+        return index.contains(key);
+    }
+
+    // Cache `answer` under `key`. `responseSize` is the size of the response it came from.
+    void insert(const CacheKey& key, std::string answer, std::size_t responseSize)
+    {
+        auto found = index.find(key);
+
+        if (found != index.end())
+        {
+            size -= entrySize(*found->second);
+            entries.erase(found->second);
+            index.erase(found);
+        }
+
+        entries.push_front({ key, std::move(answer), responseSize });
+        index[key] = entries.begin();
+        size += entrySize(entries.front());
+
+        // Evict from the back of the list
+        while (size > capacity && !entries.empty())
+        {
+            size -= entrySize(entries.back());
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    std::size_t lookupCount() const
+    {
+        return lookups;
+    }
+
+    std::size_t hitCount() const
+    {
+        return hits;
+    }
+
+    double hitRatio() const
+    {
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+
+    // Size of the responses that did not have to be downloaded
+    std::size_t bytesSavedCount() const
+    {
+        return bytesSaved;
+    }
+
+private:
+    struct Entry
+    {
+        CacheKey key;
+        std::string answer;
+        std::size_t responseSize;
+    };
+
+    // Bytes taken by an entry, including an estimate of the list and index overhead
+    static std::size_t entrySize(const Entry& entry)
+    {
+        return sizeof(Entry) + entry.answer.size() + 64;
+    }
+
+    std::size_t capacity;
+    std::size_t size = 0;
+
+    // Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<CacheKey, std::list<Entry>::iterator, CacheKeyHash> index;
+
+    std::size_t lookups = 0;
+    std::size_t hits = 0;
+    std::size_t bytesSaved = 0;
+};
+
+#endif //MAGNUS_LIBER_RESPONSE_CACHE_HPP
@@ -0,0 +1,136 @@
+#ifndef MAGNUS_LIBER_SEMANTIC_CACHE_HPP
+#define MAGNUS_LIBER_SEMANTIC_CACHE_HPP
+
+#include "history_selector.hpp"
+#include "hnsw_index.hpp"
+#include "vector_math.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr double DEFAULT_SEMANTIC_THRESHOLD = 0.92;
+
+// Embedding used when no embeddings deployment is configured: the trigram vector of the meaningful words.
+// It only matches questions that share most of their words, but needs no request.
+inline std::vector<float> localEmbedding(std::string_view text)
+{
+    auto terms = relevanceTerms(text);
+    std::vector<std::string> sortedTerms(terms.begin(), terms.end());
+    std::sort(sortedTerms.begin(), sortedTerms.end());
+
+    std::string joined;
+
+    for (const auto& term : sortedTerms)
+    {
+        joined += ' ';
+        joined += term;
+    }
+
+    auto vector = trigramVector(joined);
+
+    return std::vector<float>(vector.begin(), vector.end());
+}
+
+// Answers to previous questions, found by meaning rather than by exact text.
+//
+// Questions are embedded and indexed in an HNSW graph. A question reuses the answer of the most similar
+// previous question if their similarity is at least `threshold`.
+// A follow-up such as "Who followed him?" means something else after each question, so the question asked
+// just before must be similar too.
+class SemanticCache
+{
+public:
+    SemanticCache(double threshold, std::size_t capacity)
+        : threshold(static_cast<float>(threshold)), capacity(capacity)
+    {
+    }
+
+    // Return the answer to a question similar to `question` asked after a question similar to `previousQuestion`.
+    // Both are unit vectors; `previousQuestion` is empty at the start of a conversation.
+    std::optional<std::string> find(std::span<const float> question, std::span<const float> previousQuestion)
+    {
+        ++lookups;
+
+        if (!index || index->dimensionCount() != question.size())
+        {
+            return std::nullopt;
+        }
+
+        for (auto [similarity, entry] : index->search(question, CANDIDATE_COUNT))
+        {
+            if (similarity < threshold)
+            {
+                break;
+            }
+
+            if (sameContext(previousQuestions[entry], previousQuestion))
+            {
+                ++hits;
+                return answers[entry];
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    // Cache `answer` to `question`. Once the cache is full, new answers are left to the exact-match caches.
+    void insert(std::span<const float> question, std::span<const float> previousQuestion, std::string answer)
+    {
+        if (!index)
+        {
+            index.emplace(question.size());
+        }
+
+        if (index->size() >= capacity || index->dimensionCount() != question.size())
+        {
+            return;
+        }
+
+        index->add(question);
+        previousQuestions.emplace_back(previousQuestion.begin(), previousQuestion.end());
+        answers.push_back(std::move(answer));
+    }
+
+    std::size_t lookupCount() const
+    {
+        return lookups;
+    }
+
+    std::size_t hitCount() const
+    {
+        return hits;
+    }
+
+private:
+    bool sameContext(std::span<const float> cachedPrevious, std::span<const float> previousQuestion) const
+    {
+        if (cachedPrevious.empty() || previousQuestion.empty())
+        {
+            return cachedPrevious.empty() && previousQuestion.empty();
+        }
+
+        return cachedPrevious.size() == previousQuestion.size() && dotProduct(cachedPrevious, previousQuestion) >= threshold;
+    }
+
+    // Number of similar questions checked for a matching context
+    static constexpr std::size_t CANDIDATE_COUNT = 8;
+
+    float threshold;
+    std::size_t capacity;
+
+    // Created with the dimensions of the first embedding, which depend on the model
+    std::optional<HnswIndex> index;
+
+    // Question asked before and answer of each entry, by identifier in the index
+    std::vector<std::vector<float>> previousQuestions;
+    std::vector<std::string> answers;
+
+    std::size_t lookups = 0;
+    std::size_t hits = 0;
+};
+
+#endif //MAGNUS_LIBER_SEMANTIC_CACHE_HPP
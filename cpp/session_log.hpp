@@ -0,0 +1,300 @@
+#ifndef MAGNUS_LIBER_SESSION_LOG_HPP
+#define MAGNUS_LIBER_SESSION_LOG_HPP
+
+#include "conversation_tree.hpp"
+#include "mapped_file.hpp"
+#include "openai.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+// Session logs are append-only files of length-prefixed records:
+//
+//   [magic "MLOG"][version: uint32]
+//   [length: uint32][role: uint8][parent: uint64][content: length bytes][length: uint32]
+//   ...
+//
+// `parent` is the offset of the record of the previous message in the same branch of the conversation, or 0
+// for the first message, so the messages of every branch are logged in the order they were written, and the
+// branch of any message is found by following the parents back.
+//
+// The trailing copy of the length lets a reader find the last record from the end, so resuming a session
+// only touches the last few records of its branch regardless of how long the session is.
+
+constexpr auto SESSION_LOG_EXTENSION = ".session";
+constexpr char SESSION_LOG_MAGIC[4] = { 'M', 'L', 'O', 'G' };
+constexpr std::uint32_t SESSION_LOG_VERSION = 2;
+constexpr std::size_t SESSION_LOG_HEADER_SIZE = sizeof(SESSION_LOG_MAGIC) + sizeof(std::uint32_t);
+constexpr std::size_t SESSION_LOG_CONTENT_OFFSET = sizeof(std::uint32_t) + sizeof(std::uint8_t) + sizeof(std::uint64_t);
+constexpr std::size_t SESSION_LOG_RECORD_OVERHEAD = SESSION_LOG_CONTENT_OFFSET + sizeof(std::uint32_t);
+
+// When appended records are flushed to disk
+enum class FsyncPolicy
+{
+    Always,     // After every record
+    Periodic,   // At most once per second
+    Never,      // Left to the operating system
+};
+
+// Roles are stored as the single byte value of `Role`
+inline bool isValidRole(std::uint8_t role)
+{
+    return role < std::size(ROLE_NAMES);
+}
+
+// Appends chat messages to a session log
+class SessionLog
+{
+public:
+    SessionLog(std::string path, FsyncPolicy fsyncPolicy)
+        : path(std::move(path)), fsyncPolicy(fsyncPolicy)
+    {
+        repairTail();
+
+        auto isNew = !std::filesystem::exists(this->path) || std::filesystem::file_size(this->path) == 0;
+
+        file = std::fopen(this->path.c_str(), "ab");
+
+        if (file == nullptr)
+        {
+            throw std::runtime_error("Failed to open session log " + this->path);
+        }
+
+        if (isNew)
+        {
+            std::fwrite(SESSION_LOG_MAGIC, 1, sizeof(SESSION_LOG_MAGIC), file);
+            std::fwrite(&SESSION_LOG_VERSION, sizeof(SESSION_LOG_VERSION), 1, file);
+            std::fflush(file);
+            size = SESSION_LOG_HEADER_SIZE;
+        }
+        else
+        {
+            size = std::filesystem::file_size(this->path);
+        }
+    }
+
+    SessionLog(const SessionLog&) = delete;
+    SessionLog& operator=(const SessionLog&) = delete;
+
+    ~SessionLog()
+    {
+        if (file != nullptr)
+        {
+            if (fsyncPolicy != FsyncPolicy::Never)
+            {
+                sync();
+            }
+
+            std::fclose(file);
+        }
+    }
+
+    // Append a message to the end of the log, after the message logged at `parent` in its branch (0 for the first
+    // message of the conversation). Returns the offset of the new record, the parent of the next message.
+    std::uint64_t append(ChatMessageView message, std::uint64_t parent)
+    {
+        auto offset = size;
+        auto length = static_cast<std::uint32_t>(message.content.size());
+        auto role = static_cast<std::uint8_t>(message.role);
+
+        std::fwrite(&length, sizeof(length), 1, file);
+        std::fwrite(&role, sizeof(role), 1, file);
+        std::fwrite(&parent, sizeof(parent), 1, file);
+        std::fwrite(message.content.data(), 1, message.content.size(), file);
+        std::fwrite(&length, sizeof(length), 1, file);
+
+        size += SESSION_LOG_RECORD_OVERHEAD + length;
+
+        auto now = std::chrono::steady_clock::now();
+
+        if (fsyncPolicy == FsyncPolicy::Always || (fsyncPolicy == FsyncPolicy::Periodic && now - lastSync >= std::chrono::seconds(1)))
+        {
+            sync();
+            lastSync = now;
+        }
+
+        return offset;
+    }
+
+    // Map the log at `path` and append to `history` the last `count` messages of the branch of the last message
+    // logged, oldest first. Messages of other branches are skipped. Only those records are read: the branch is
+    // walked backwards from the end through the parents.
+    // Returns the offset of the last record, the parent of the next message, or 0 if the log is empty.
+    static std::uint64_t readWindow(const std::string& path, std::size_t count, ConversationTree& history)
+    {
+        MappedFile mapping(path);
+
+        // A log created but not yet written to
+        if (mapping.size() == 0)
+        {
+            return 0;
+        }
+
+        if (!hasHeader(mapping))
+        {
+            throw std::runtime_error(path + " is not a session log of this version");
+        }
+
+        // Find the start of the last `count` records of the branch
+        std::vector<std::size_t> starts;
+        auto last = previousRecord(mapping, mapping.size());
+
+        for (auto start = last; start != 0 && starts.size() < count;)
+        {
+            starts.push_back(start);
+
+            std::uint64_t parent;
+            std::memcpy(&parent, mapping.data() + start + sizeof(std::uint32_t) + sizeof(std::uint8_t), sizeof(parent));
+
+            // Parents are always written before their children
+            start = parent < start && isRecord(mapping, parent) ? parent : 0;
+        }
+
+        // Copy them into the history, oldest first
+        for (auto start = starts.rbegin(); start != starts.rend(); ++start)
+        {
+            std::uint32_t length;
+            std::uint8_t role;
+            std::memcpy(&length, mapping.data() + *start, sizeof(length));
+            std::memcpy(&role, mapping.data() + *start + sizeof(length), sizeof(role));
+
+            history.push(static_cast<Role>(role), std::string_view(mapping.data() + *start + SESSION_LOG_CONTENT_OFFSET, length));
+        }
+
+        return last;
+    }
+
+private:
+    static bool hasHeader(const MappedFile& mapping)
+    {
+        if (mapping.size() < SESSION_LOG_HEADER_SIZE || std::memcmp(mapping.data(), SESSION_LOG_MAGIC, sizeof(SESSION_LOG_MAGIC)) != 0)
+        {
+            return false;
+        }
+
+        std::uint32_t version;
+        std::memcpy(&version, mapping.data() + sizeof(SESSION_LOG_MAGIC), sizeof(version));
+
+        return version == SESSION_LOG_VERSION;
+    }
+
+    // Whether a whole valid record starts at `start`
+    static bool isRecord(const MappedFile& mapping, std::uint64_t start)
+    {
+        if (start < SESSION_LOG_HEADER_SIZE || start + SESSION_LOG_RECORD_OVERHEAD > mapping.size())
+        {
+            return false;
+        }
+
+        std::uint32_t length;
+        std::memcpy(&length, mapping.data() + start, sizeof(length));
+
+        auto end = start + SESSION_LOG_RECORD_OVERHEAD + length;
+
+        return end <= mapping.size() && previousRecord(mapping, end) == start;
+    }
+
+    // Return the start of the record ending at `end`, or 0 if there is no valid record there
+    static std::size_t previousRecord(const MappedFile& mapping, std::size_t end)
+    {
+        if (end < SESSION_LOG_HEADER_SIZE + SESSION_LOG_RECORD_OVERHEAD)
+        {
+            return 0;
+        }
+
+        std::uint32_t trailingLength;
+        std::memcpy(&trailingLength, mapping.data() + end - sizeof(trailingLength), sizeof(trailingLength));
+
+        auto recordSize = SESSION_LOG_RECORD_OVERHEAD + trailingLength;
+
+        if (recordSize > end - SESSION_LOG_HEADER_SIZE)
+        {
+            return 0;
+        }
+
+        auto start = end - recordSize;
+
+        std::uint32_t leadingLength;
+        std::uint8_t role;
+        std::memcpy(&leadingLength, mapping.data() + start, sizeof(leadingLength));
+        std::memcpy(&role, mapping.data() + start + sizeof(leadingLength), sizeof(role));
+
+        return leadingLength == trailingLength && isValidRole(role) ? start : 0;
+    }
+
+    // Truncate a record left half-written by a crash so new records append to a valid log
+    void repairTail()
+    {
+        if (!std::filesystem::exists(path) || std::filesystem::file_size(path) == 0)
+        {
+            return;
+        }
+
+        std::size_t validEnd;
+
+        {
+            MappedFile mapping(path);
+
+            if (!hasHeader(mapping))
+            {
+                throw std::runtime_error(path + " is not a session log of this version");
+            }
+
+            if (mapping.size() == SESSION_LOG_HEADER_SIZE || previousRecord(mapping, mapping.size()) != 0)
+            {
+                return;
+            }
+
+            // The tail is damaged: scan forward to the end of the last complete record
+            validEnd = SESSION_LOG_HEADER_SIZE;
+
+            while (validEnd + SESSION_LOG_RECORD_OVERHEAD <= mapping.size())
+            {
+                std::uint32_t length;
+                std::memcpy(&length, mapping.data() + validEnd, sizeof(length));
+
+                auto end = validEnd + SESSION_LOG_RECORD_OVERHEAD + length;
+
+                if (end > mapping.size() || previousRecord(mapping, end) != validEnd)
+                {
+                    break;
+                }
+
+                validEnd = end;
+            }
+        }
+
+        std::filesystem::resize_file(path, validEnd);
+    }
+
+    void sync()
+    {
+        std::fflush(file);
+
+#ifdef _WIN32
+        _commit(_fileno(file));
+#else
+        ::fsync(fileno(file));
+#endif
+    }
+
+    std::string path;
+    FsyncPolicy fsyncPolicy;
+    std::FILE* file = nullptr;
+    std::uint64_t size = 0;
+    std::chrono::steady_clock::time_point lastSync = std::chrono::steady_clock::now();
+};
+
+#endif //MAGNUS_LIBER_SESSION_LOG_HPP
@@ -0,0 +1,76 @@
+#ifndef MAGNUS_LIBER_SINGLE_FLIGHT_HPP
+#define MAGNUS_LIBER_SINGLE_FLIGHT_HPP
+
+#include "response_cache.hpp"
+
+#include <atomic>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Coalesces identical requests sent at the same time.
+//
+// The first caller for a key sends the request. Callers arriving with the same key while it is in flight wait
+// for its response instead of sending their own, so a popular question, or a burst of cache misses after a
+// restart, costs a single request. A failure is reported to every caller waiting on it.
+class SingleFlight
+{
+public:
+    // Return the response for `key`, calling `fetch` only if no request for it is in flight
+    template <typename Fetch>
+    std::string run(const CacheKey& key, Fetch fetch)
+    {
+        std::unique_lock lock(mutex);
+
+        if (auto flight = flights.find(key); flight != flights.end())
+        {
+            auto response = flight->second;
+            lock.unlock();
+
+            ++coalesced;
+
+            return response.get();
+        }
+
+        std::promise<std::string> promise;
+        flights.emplace(key, promise.get_future().share());
+        lock.unlock();
+
+        try
+        {
+            auto response = fetch();
+            promise.set_value(response);
+            land(key);
+
+            return response;
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+            land(key);
+
+            throw;
+        }
+    }
+
+    // Number of requests answered by another caller's request
+    std::size_t coalescedCount() const
+    {
+        return coalesced;
+    }
+
+private:
+    void land(const CacheKey& key)
+    {
+        std::lock_guard lock(mutex);
+        flights.erase(key);
+    }
+
+    std::mutex mutex;
+    std::unordered_map<CacheKey, std::shared_future<std::string>, CacheKeyHash> flights;
+    std::atomic<std::size_t> coalesced = 0;
+};
+
+#endif //MAGNUS_LIBER_SINGLE_FLIGHT_HPP
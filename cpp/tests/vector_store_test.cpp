@@ -0,0 +1,100 @@
+// Checks that chunkText splits long paragraphs without losing or adding text, and keeps chunks within their size.
+//
+// Usage: VectorStoreTest
+
+#include "../vector_store.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::size_t failures = 0;
+
+    void check(bool condition, const std::string& description)
+    {
+        if (!condition)
+        {
+            std::cerr << "Failed: " << description << std::endl;
+            ++failures;
+        }
+    }
+
+    std::vector<std::string> chunk(std::string_view text, std::size_t maxSize)
+    {
+        std::vector<std::string> chunks;
+        chunkText(text, maxSize, chunks);
+
+        return chunks;
+    }
+
+    std::string join(const std::vector<std::string>& chunks, std::string_view separator)
+    {
+        std::string text;
+
+        for (const auto& chunk : chunks)
+        {
+            text += text.empty() ? "" : separator;
+            text += chunk;
+        }
+
+        return text;
+    }
+}
+
+int main()
+{
+    // A paragraph with no sentence breaks is cut at the size of a chunk, keeping every byte
+    {
+        std::string paragraph;
+
+        for (std::size_t i = 0; i < 1000; ++i)
+        {
+            paragraph += static_cast<char>('a' + i % 26);
+        }
+
+        auto chunks = chunk(paragraph, 64);
+
+        check(join(chunks, "") == paragraph, "a paragraph without sentences is split without losing bytes");
+        check(chunks.size() == 16, "a paragraph of 1000 bytes fills 16 chunks of 64 bytes");
+
+        for (const auto& c : chunks)
+        {
+            check(c.size() <= 64, "a forced split stays within the chunk size");
+        }
+    }
+
+    // A sentence ending exactly at the size of a chunk does not make the chunk longer
+    {
+        std::string paragraph = std::string(64, 'a') + ". " + std::string(100, 'b');
+        auto chunks = chunk(paragraph, 64);
+
+        for (const auto& c : chunks)
+        {
+            check(c.size() <= 64, "a sentence ending at the chunk size stays within it");
+        }
+
+        check(join(chunks, "") == std::string(64, 'a') + "." + std::string(100, 'b'), "only the space after a sentence is dropped");
+    }
+
+    // Sentences are kept whole, and only the space after them is dropped
+    {
+        std::string paragraph = "Augustus ruled. Tiberius followed. Caligula was murdered. Claudius was proclaimed.";
+        auto chunks = chunk(paragraph, 40);
+
+        check(join(chunks, " ") == paragraph, "a paragraph split at sentences is rebuilt by joining them with spaces");
+
+        for (const auto& c : chunks)
+        {
+            check(c.size() <= 40 && c.ends_with('.'), "chunks end at a sentence: " + c);
+        }
+    }
+
+    if (failures > 0)
+    {
+        return 1;
+    }
+
+    std::cout << "All chunkText checks passed." << std::endl;
+}
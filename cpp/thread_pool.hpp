@@ -0,0 +1,230 @@
+#ifndef MAGNUS_LIBER_THREAD_POOL_HPP
+#define MAGNUS_LIBER_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs CPU-bound work, such as scoring a corpus or embedding passages, on a fixed set of threads.
+//
+// Each thread has its own queue. Tasks submitted from a thread of the pool go to the back of its queue and it
+// takes them back from there, while their data is still in its cache. A thread whose queue is empty steals
+// from the front of the others', so no thread idles while another has a backlog.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t threadCount)
+    {
+        threadCount = std::max<std::size_t>(threadCount, 1);
+
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            queues.push_back(std::make_unique<Queue>());
+        }
+
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(sleepMutex);
+            stopping = true;
+        }
+
+        wake.notify_all();
+    }
+
+    std::size_t threadCount() const
+    {
+        return queues.size();
+    }
+
+    // Run `task` on a thread of the pool
+    template<typename Task>
+    void submit(Task task)
+    {
+        // From a thread of this pool, keep the task on that thread; from elsewhere, spread tasks evenly
+        auto index = currentPool == this ? currentIndex : nextQueue++ % queues.size();
+
+        {
+            std::lock_guard lock(queues[index]->mutex);
+            queues[index]->tasks.emplace_back(std::move(task));
+        }
+
+        {
+            std::lock_guard lock(sleepMutex);
+            ++queued;
+        }
+
+        wake.notify_one();
+    }
+
+    // Call `function(i)` for every `i` below `count` on the threads of the pool and the calling thread, and
+    // return once they have all returned. The first exception thrown is rethrown here.
+    template<typename Function>
+    void parallelFor(std::size_t count, Function function)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        // Shared with the helper tasks, which may only start after the loop is done
+        struct Loop
+        {
+            Function function;
+            std::size_t count;
+            std::atomic<std::size_t> next = 0;
+            std::atomic<std::size_t> done = 0;
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::exception_ptr error;
+
+            void run()
+            {
+                for (auto i = next++; i < count; i = next++)
+                {
+                    try
+                    {
+                        function(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lock(mutex);
+
+                        if (!error)
+                        {
+                            error = std::current_exception();
+                        }
+                    }
+
+                    if (++done == count)
+                    {
+                        std::lock_guard lock(mutex);
+                        finished.notify_all();
+                    }
+                }
+            }
+        };
+
+        auto loop = std::make_shared<Loop>(std::move(function), count);
+
+        for (std::size_t i = 1; i < std::min(count, threadCount() + 1); ++i)
+        {
+            submit([loop]() { loop->run(); });
+        }
+
+        // Work too rather than wait, so a loop started from a busy pool still progresses
+        loop->run();
+
+        std::unique_lock lock(loop->mutex);
+        loop->finished.wait(lock, [&]() { return loop->done == count; });
+
+        if (loop->error)
+        {
+            std::rethrow_exception(loop->error);
+        }
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Take the next task of thread `index`: its most recent one, or the oldest one of another thread
+    std::function<void()> take(std::size_t index)
+    {
+        for (std::size_t i = 0; i < queues.size(); ++i)
+        {
+            auto& queue = *queues[(index + i) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+
+            if (!queue.tasks.empty())
+            {
+                std::function<void()> task;
+
+                if (i == 0)
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void work(std::size_t index)
+    {
+        currentPool = this;
+        currentIndex = index;
+
+        while (true)
+        {
+            {
+                std::unique_lock lock(sleepMutex);
+                wake.wait(lock, [&]() { return queued > 0 || stopping; });
+
+                // Finish the tasks already submitted before stopping
+                if (queued == 0)
+                {
+                    return;
+                }
+
+                --queued;
+            }
+
+            // The task counted may have been taken by a thread that did not wait: look until one is found
+            for (auto task = take(index);; task = take(index))
+            {
+                if (task)
+                {
+                    task();
+                    break;
+                }
+
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    inline static thread_local ThreadPool* currentPool = nullptr;
+    inline static thread_local std::size_t currentIndex = 0;
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<std::size_t> nextQueue = 0;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::size_t queued = 0;
+    bool stopping = false;
+
+    // Last, so the threads are joined before the queues are destroyed
+    std::vector<std::jthread> threads;
+};
+
+#endif //MAGNUS_LIBER_THREAD_POOL_HPP
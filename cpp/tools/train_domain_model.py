@@ -0,0 +1,142 @@
+"""Train the out-of-domain classifier of Magnus Liber and write its weights to domain_model.hpp.
+
+The model is a logistic regression over hashed character 3-grams and 4-grams and whole words of the
+question. The features must be computed exactly as `outOfDomainProbability` in domain_classifier.hpp does.
+
+Usage: python3 train_domain_model.py
+"""
+
+import math
+import os
+import random
+
+BUCKET_COUNT = 4096
+EPOCHS = 40
+LEARNING_RATE = 0.5
+L2 = 1e-4
+THRESHOLD = 0.9
+FOLDS = 5
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+
+def fnv1a(data):
+    hash = 2166136261
+    for byte in data:
+        hash = ((hash ^ byte) * 16777619) & 0xFFFFFFFF
+    return hash
+
+
+def normalise(text):
+    # Lowercase ASCII letters and digits, every other byte a single space, like normaliseName
+    words = bytes(b | 0x20 if 65 <= b <= 90 else b if (48 <= b <= 57 or 97 <= b <= 122) else 32 for b in text.encode())
+    return b" ".join(words.split())
+
+
+def features(text):
+    normalised = normalise(text)
+    padded = b" " + normalised + b" "
+    buckets = []
+    for n in (3, 4):
+        for i in range(len(padded) - n + 1):
+            buckets.append(fnv1a(padded[i:i + n]) & (BUCKET_COUNT - 1))
+    for word in normalised.split():
+        buckets.append(fnv1a(b"\x01" + word) & (BUCKET_COUNT - 1))
+    return buckets
+
+
+def score(model, buckets):
+    weights, bias = model
+    if not buckets:
+        return bias
+    return bias + sum(weights[b] for b in buckets) / math.sqrt(len(buckets))
+
+
+def probability(model, buckets):
+    return 1.0 / (1.0 + math.exp(-score(model, buckets)))
+
+
+def train(examples):
+    weights = [0.0] * BUCKET_COUNT
+    bias = 0.0
+    examples = list(examples)
+    positives = sum(label for _, label in examples)
+    # Balance the classes
+    classWeights = {1: len(examples) / (2 * positives), 0: len(examples) / (2 * (len(examples) - positives))}
+    rng = random.Random(1)
+    for epoch in range(EPOCHS):
+        rng.shuffle(examples)
+        rate = LEARNING_RATE / (1 + epoch * 0.1)
+        for buckets, label in examples:
+            error = (probability((weights, bias), buckets) - label) * classWeights[label]
+            scale = 1.0 / math.sqrt(len(buckets)) if buckets else 0.0
+            for b in buckets:
+                weights[b] -= rate * (error * scale + L2 * weights[b])
+            bias -= rate * error
+    return weights, bias
+
+
+def load():
+    examples = []
+    with open(os.path.join(here, "domain_questions.txt")) as file:
+        for line in file:
+            if line.startswith("#") or not line.strip():
+                continue
+            label, question = line.rstrip("\n").split("\t", 1)
+            examples.append((features(question), 1 if label == "out" else 0))
+    return examples
+
+
+def crossValidate(examples):
+    rng = random.Random(2)
+    shuffled = list(examples)
+    rng.shuffle(shuffled)
+    truePositives = falsePositives = falseNegatives = 0
+    for fold in range(FOLDS):
+        test = shuffled[fold::FOLDS]
+        training = [e for i, e in enumerate(shuffled) if i % FOLDS != fold]
+        model = train(training)
+        for buckets, label in test:
+            predicted = probability(model, buckets) >= THRESHOLD
+            truePositives += predicted and label == 1
+            falsePositives += predicted and label == 0
+            falseNegatives += not predicted and label == 1
+    precision = truePositives / max(1, truePositives + falsePositives)
+    recall = truePositives / max(1, truePositives + falseNegatives)
+    print(f"{FOLDS}-fold cross-validation at threshold {THRESHOLD}: precision {precision:.3f}, recall {recall:.3f} "
+          f"({falsePositives} in-domain questions refused)")
+
+
+def write(model):
+    weights, bias = model
+    scale = max(abs(w) for w in weights) / 127
+    quantised = [round(w / scale) for w in weights]
+    rows = [", ".join(f"{q:4d}" for q in quantised[i:i + 16]) for i in range(0, BUCKET_COUNT, 16)]
+    with open(os.path.join(here, "..", "domain_model.hpp"), "w") as file:
+        file.write(f"""#ifndef MAGNUS_LIBER_DOMAIN_MODEL_HPP
+#define MAGNUS_LIBER_DOMAIN_MODEL_HPP
+
+// Generated by tools/train_domain_model.py from tools/domain_questions.txt. Do not edit.
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr std::size_t DOMAIN_MODEL_BUCKET_COUNT = {BUCKET_COUNT};
+constexpr float DOMAIN_MODEL_BIAS = {bias:.6f}f;
+constexpr float DOMAIN_MODEL_SCALE = {scale:.8f}f;
+constexpr float DOMAIN_MODEL_THRESHOLD = {THRESHOLD}f;
+
+// Weight of each feature bucket, multiplied by DOMAIN_MODEL_SCALE
+constexpr std::int8_t DOMAIN_MODEL_WEIGHTS[DOMAIN_MODEL_BUCKET_COUNT] = {{
+""")
+        file.write("".join(f"    {row},\n" for row in rows))
+        file.write("""};
+
+#endif //MAGNUS_LIBER_DOMAIN_MODEL_HPP
+""")
+
+
+if __name__ == "__main__":
+    examples = load()
+    crossValidate(examples)
+    write(train(examples))
@@ -0,0 +1,95 @@
+#ifndef MAGNUS_LIBER_VECTOR_MATH_HPP
+#define MAGNUS_LIBER_VECTOR_MATH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <span>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Dot product of two vectors of `size` floats.
+// Uses AVX2 when the compiler targets it (for example with `-march=native`), SSE2 on any other x86-64 and
+// NEON on ARM. Several accumulators are used so consecutive additions do not wait on each other.
+inline float dotProduct(const float* a, const float* b, std::size_t size)
+{
+    std::size_t i = 0;
+    float sum = 0.0f;
+
+#if defined(__AVX2__) && defined(__FMA__)
+    auto sum0 = _mm256_setzero_ps();
+    auto sum1 = _mm256_setzero_ps();
+
+    for (; i + 16 <= size; i += 16)
+    {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+
+    auto sum8 = _mm256_add_ps(sum0, sum1);
+    auto sum4 = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+    sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+    sum = _mm_cvtss_f32(sum4);
+#elif defined(__SSE2__) || defined(_M_X64)
+    auto sum0 = _mm_setzero_ps();
+    auto sum1 = _mm_setzero_ps();
+
+    for (; i + 8 <= size; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+
+    auto sum4 = _mm_add_ps(sum0, sum1);
+    sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+    sum = _mm_cvtss_f32(sum4);
+#elif defined(__ARM_NEON)
+    auto sum0 = vdupq_n_f32(0.0f);
+    auto sum1 = vdupq_n_f32(0.0f);
+
+    for (; i + 8 <= size; i += 8)
+    {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+
+    auto sum4 = vaddq_f32(sum0, sum1);
+    sum = vgetq_lane_f32(sum4, 0) + vgetq_lane_f32(sum4, 1) + vgetq_lane_f32(sum4, 2) + vgetq_lane_f32(sum4, 3);
+#endif
+
+    for (; i < size; ++i)
+    {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+inline float dotProduct(std::span<const float> a, std::span<const float> b)
+{
+    return dotProduct(a.data(), b.data(), std::min(a.size(), b.size()));
+}
+
+// Scale `vector` to unit length, so the dot product of two vectors is their cosine similarity
+inline void normalise(std::span<float> vector)
+{
+    auto norm = std::sqrt(dotProduct(vector, vector));
+
+    if (norm > 0.0f)
+    {
+        for (auto& value : vector)
+        {
+            value /= norm;
+        }
+    }
+}
+
+#endif //MAGNUS_LIBER_VECTOR_MATH_HPP
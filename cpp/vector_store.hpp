@@ -0,0 +1,282 @@
+#ifndef MAGNUS_LIBER_VECTOR_STORE_HPP
+#define MAGNUS_LIBER_VECTOR_STORE_HPP
+
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "vector_math.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Vector stores hold the chunks of a corpus and their embeddings. They are written once by `--index-corpus`
+// and memory-mapped at run time:
+//
+//   [header: VectorStoreHeader]
+//   [vectors: chunkCount * dimensions floats, unit length]
+//   [chunks: chunkCount * { offset: uint64, length: uint64 }, into the text]
+//   [text of the chunks]
+//
+// The vectors come first so they are aligned and contiguous, and a search reads nothing else.
+
+constexpr auto CORPUS_VECTORS_FILE = "corpus.vectors";
+constexpr char VECTOR_STORE_MAGIC[8] = { 'M', 'L', 'V', 'E', 'C', 'S', '0', '1' };
+
+// Chunks are about this many bytes: a few paragraphs, small enough to send several with a question
+constexpr std::size_t CORPUS_CHUNK_SIZE = 1000;
+
+// Passages are only sent with a question if they are at least this similar to it
+constexpr float MIN_PASSAGE_SIMILARITY = 0.3f;
+
+// Introduces the passages sent with a question
+constexpr auto PASSAGES_PREFIX = "Passages from the library of Magnus Liber Imperatorum. Rely on them where they answer the question:";
+
+struct VectorStoreHeader
+{
+    char magic[8];
+    std::uint32_t dimensions;
+    std::uint32_t reserved;
+    std::uint64_t chunkCount;
+    std::uint64_t chunksOffset;
+    std::uint64_t textOffset;
+
+    // Name of the embedding model, so questions are embedded the same way as the corpus
+    char model[24];
+};
+
+static_assert(sizeof(VectorStoreHeader) == 64);
+
+// Split `text` into chunks of up to about `maxSize` bytes, at paragraph boundaries where possible
+inline void chunkText(std::string_view text, std::size_t maxSize, std::vector<std::string>& chunks)
+{
+    std::string chunk;
+
+    auto flush = [&]() {
+        if (!chunk.empty())
+        {
+            chunks.push_back(std::move(chunk));
+            chunk.clear();
+        }
+    };
+
+    for (std::size_t start = 0; start < text.size();)
+    {
+        auto end = text.find("\n\n", start);
+        end = end == std::string_view::npos ? text.size() : end;
+
+        auto paragraph = text.substr(start, end - start);
+        start = end + 2;
+
+        while (!paragraph.empty() && std::isspace(static_cast<unsigned char>(paragraph.front())))
+        {
+            paragraph.remove_prefix(1);
+        }
+
+        if (paragraph.empty())
+        {
+            continue;
+        }
+
+        if (!chunk.empty() && chunk.size() + paragraph.size() + 2 > maxSize)
+        {
+            flush();
+        }
+
+        // Split paragraphs longer than a chunk after the last sentence that fits, or else at `maxSize`.
+        // The space after a sentence is dropped; nothing else is.
+        while (paragraph.size() > maxSize)
+        {
+            auto sentenceEnd = paragraph.rfind(". ", maxSize - 1);
+            auto split = sentenceEnd == std::string_view::npos ? maxSize : sentenceEnd + 1;
+
+            chunk.append(paragraph.substr(0, split));
+            flush();
+            paragraph.remove_prefix(sentenceEnd == std::string_view::npos ? split : split + 1);
+        }
+
+        if (!chunk.empty())
+        {
+            chunk += "\n\n";
+        }
+
+        chunk.append(paragraph);
+    }
+
+    flush();
+}
+
+// Write a vector store of `chunks` and their unit `vectors`, one after the other
+inline void writeVectorStore(const std::filesystem::path& path, std::string_view model, std::size_t dimensions, const std::vector<std::string>& chunks, const std::vector<float>& vectors)
+{
+    VectorStoreHeader header {};
+    std::memcpy(header.magic, VECTOR_STORE_MAGIC, sizeof(header.magic));
+    std::memcpy(header.model, model.data(), std::min(model.size(), sizeof(header.model) - 1));
+    header.dimensions = static_cast<std::uint32_t>(dimensions);
+    header.chunkCount = chunks.size();
+    header.chunksOffset = sizeof(header) + vectors.size() * sizeof(float);
+    header.textOffset = header.chunksOffset + chunks.size() * 2 * sizeof(std::uint64_t);
+
+    // Write to a temporary file and rename it, so a running client never maps a partial store
+    auto temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(vectors.data()), static_cast<std::streamsize>(vectors.size() * sizeof(float)));
+
+        std::uint64_t offset = 0;
+
+        for (const auto& chunk : chunks)
+        {
+            std::uint64_t entry[2] = { offset, chunk.size() };
+            file.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+            offset += chunk.size();
+        }
+
+        for (const auto& chunk : chunks)
+        {
+            file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("Failed to write " + temporaryPath.string());
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path);
+}
+
+// A read-only, memory-mapped vector store
+class VectorStore
+{
+public:
+    // Similarity and index of a chunk
+    using Match = std::pair<float, std::uint32_t>;
+
+    explicit VectorStore(const std::string& path)
+        : mapping(path)
+    {
+        if (mapping.size() < sizeof(VectorStoreHeader))
+        {
+            throw std::runtime_error(path + " is not a vector store");
+        }
+
+        std::memcpy(&header, mapping.data(), sizeof(header));
+
+        auto vectorsSize = header.chunkCount * header.dimensions * sizeof(float);
+        auto chunksSize = header.chunkCount * 2 * sizeof(std::uint64_t);
+
+        if (std::memcmp(header.magic, VECTOR_STORE_MAGIC, sizeof(header.magic)) != 0
+            || header.chunksOffset != sizeof(header) + vectorsSize
+            || header.textOffset != header.chunksOffset + chunksSize
+            || header.textOffset > mapping.size())
+        {
+            throw std::runtime_error(path + " is not a valid vector store");
+        }
+    }
+
+    std::size_t size() const
+    {
+        return header.chunkCount;
+    }
+
+    std::size_t dimensions() const
+    {
+        return header.dimensions;
+    }
+
+    std::string_view model() const
+    {
+        return { header.model, strnlen(header.model, sizeof(header.model)) };
+    }
+
+    std::string_view chunk(std::uint32_t index) const
+    {
+        std::uint64_t entry[2];
+        std::memcpy(entry, mapping.data() + header.chunksOffset + index * sizeof(entry), sizeof(entry));
+
+        return mapping.view().substr(header.textOffset + entry[0], entry[1]);
+    }
+
+    // Return the `count` chunks most similar to the unit vector `query`, most similar first.
+    // Every vector is compared; large stores are split between the threads of `threadPool`.
+    std::vector<Match> search(std::span<const float> query, std::size_t count, ThreadPool& threadPool) const
+    {
+        if (query.size() != dimensions() || size() == 0)
+        {
+            return {};
+        }
+
+        auto threadCount = std::clamp<std::size_t>(size() / MIN_VECTORS_PER_THREAD, 1, threadPool.threadCount());
+        std::vector<std::vector<Match>> sliceMatches(threadCount);
+
+        auto searchSlice = [&](std::size_t slice) {
+            auto begin = size() * slice / threadCount;
+            auto end = size() * (slice + 1) / threadCount;
+
+            // Least similar of the best matches on top
+            std::priority_queue<Match, std::vector<Match>, std::greater<>> best;
+
+            for (auto i = begin; i < end; ++i)
+            {
+                auto similarity = dotProduct(query.data(), vector(i), dimensions());
+
+                if (best.size() < count)
+                {
+                    best.emplace(similarity, static_cast<std::uint32_t>(i));
+                }
+                else if (similarity > best.top().first)
+                {
+                    best.pop();
+                    best.emplace(similarity, static_cast<std::uint32_t>(i));
+                }
+            }
+
+            for (; !best.empty(); best.pop())
+            {
+                sliceMatches[slice].push_back(best.top());
+            }
+        };
+
+        threadPool.parallelFor(threadCount, searchSlice);
+
+        std::vector<Match> matches;
+
+        for (const auto& slice : sliceMatches)
+        {
+            matches.insert(matches.end(), slice.begin(), slice.end());
+        }
+
+        std::sort(matches.begin(), matches.end(), std::greater<>());
+        matches.resize(std::min(matches.size(), count));
+
+        return matches;
+    }
+
+private:
+    // Below this many vectors per thread, handing out the work costs more than it saves
+    static constexpr std::size_t MIN_VECTORS_PER_THREAD = 16384;
+
+    const float* vector(std::size_t index) const
+    {
+        return reinterpret_cast<const float*>(mapping.data() + sizeof(VectorStoreHeader)) + index * header.dimensions;
+    }
+
+    MappedFile mapping;
+    VectorStoreHeader header {};
+};
+
+#endif //MAGNUS_LIBER_VECTOR_STORE_HPP